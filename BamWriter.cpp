@@ -0,0 +1,332 @@
+/*
+* Filename : BamWriter.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : BGZF compressed unaligned BAM output; blocks are deflated on worker threads and written in order
+* Status: Release
+*/
+
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <zlib.h>
+#include <BamWriter.h>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+//largest uncompressed block; leaves room for incompressible data within the 64KB BGZF limit
+static const size_t BgzfBlockSize = 0xff00;
+static const size_t BgzfMaxBlockSize = 0x10000;
+static const size_t BgzfHeaderLen = 18, BgzfFooterLen = 8;
+
+static const char BgzfEOF[28] = { 31, (char) 139, 8, 4, 0, 0, 0, 0, 0, (char) 255, 6, 0, 'B', 'C', 2, 0, 27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static void AppendLittleEndian(string& Buffer, uint32_t Value, const unsigned Bytes){
+
+	for (unsigned n = 0; n < Bytes; ++n){
+		Buffer += (char) (Value & 0xff);
+		Value >>= 8;
+	}
+
+}
+
+static void CompressBgzfBlock(const string& Raw, string& Compressed){
+
+	z_stream Stream;
+	uLong Crc = crc32(0L, Z_NULL, 0);
+
+	Compressed.assign(BgzfMaxBlockSize, '\0');
+
+	//raw deflate; the gzip header carries the BC extra field with the block size
+	memset(&Stream, 0, sizeof(Stream));
+	deflateInit2(&Stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+	Stream.next_in = (Bytef*) Raw.data();
+	Stream.avail_in = Raw.length();
+	Stream.next_out = (Bytef*) &Compressed[BgzfHeaderLen];
+	Stream.avail_out = BgzfMaxBlockSize - BgzfHeaderLen - BgzfFooterLen;
+
+	deflate(&Stream, Z_FINISH); //BgzfBlockSize always fits
+	Compressed.resize(BgzfHeaderLen + Stream.total_out);
+	deflateEnd(&Stream);
+
+	Crc = crc32(Crc, (const Bytef*) Raw.data(), Raw.length());
+	AppendLittleEndian(Compressed, Crc, 4);
+	AppendLittleEndian(Compressed, Raw.length(), 4);
+
+	//gzip header, FEXTRA with BC subfield = total block size - 1
+	memcpy(&Compressed[0], BgzfEOF, 16);
+	Compressed[16] = (char) ((Compressed.length() - 1) & 0xff);
+	Compressed[17] = (char) ((Compressed.length() - 1) >> 8);
+
+}
+
+BgzfWriter::BgzfWriter(ostream& Out, const unsigned Threads) : Out(Out), Stopping(false), Closed(false) {
+
+	Pending.reserve(BgzfBlockSize);
+
+	for (unsigned n = 0; Threads > 1 && n < Threads; ++n){
+		Workers.push_back(thread(&BgzfWriter::CompressWorker, this));
+	}
+
+}
+
+BgzfWriter::~BgzfWriter(){
+	Close();
+}
+
+void BgzfWriter::CompressWorker(){
+
+	shared_ptr<bgzfblock> Block;
+
+	while (true){
+
+		{
+			unique_lock<mutex> Lock(BlockMutex);
+			WorkReady.wait(Lock, [this]{ return Stopping || !Queue.empty(); });
+
+			if (Queue.empty()){
+				return; //stopping
+			}
+
+			Block = Queue.front();
+			Queue.pop_front();
+		}
+
+		CompressBgzfBlock(Block->Raw, Block->Compressed);
+
+		{
+			lock_guard<mutex> Lock(BlockMutex);
+			Block->Done = true;
+		}
+
+		BlockDone.notify_all();
+	}
+
+}
+
+void BgzfWriter::WriteBlock(const bgzfblock& Block){
+
+	Out.write(Block.Compressed.data(), Block.Compressed.length());
+	getStageCounters().BytesWritten += Block.Compressed.length();
+
+}
+
+void BgzfWriter::SubmitBlock(){
+
+	shared_ptr<bgzfblock> Block = make_shared<bgzfblock>();
+
+	Block->Raw.swap(Pending);
+	Block->Done = false;
+	Pending.reserve(BgzfBlockSize);
+
+	if (Workers.empty()){
+		CompressBgzfBlock(Block->Raw, Block->Compressed);
+		WriteBlock(*Block);
+		return;
+	}
+
+	unique_lock<mutex> Lock(BlockMutex);
+
+	InFlight.push_back(Block);
+	Queue.push_back(Block);
+	WorkReady.notify_one();
+
+	//write finished blocks in order; bound memory to a few blocks per worker
+	while (!InFlight.empty() && (InFlight.front()->Done || InFlight.size() > Workers.size() * 4)){
+
+		BlockDone.wait(Lock, [this]{ return InFlight.front()->Done; });
+
+		WriteBlock(*InFlight.front());
+		InFlight.pop_front();
+	}
+
+}
+
+void BgzfWriter::Write(const char* Data, size_t Len){
+
+	size_t Chunk;
+
+	while (Len > 0){
+
+		Chunk = min(Len, BgzfBlockSize - Pending.length());
+		Pending.append(Data, Chunk);
+		Data += Chunk;
+		Len -= Chunk;
+
+		if (Pending.length() == BgzfBlockSize){
+			SubmitBlock();
+		}
+
+	}
+
+}
+
+void BgzfWriter::Close(){
+
+	if (Closed == true){
+		return;
+	}
+
+	Closed = true;
+
+	if (!Pending.empty()){
+		SubmitBlock();
+	}
+
+	{
+		unique_lock<mutex> Lock(BlockMutex);
+
+		while (!InFlight.empty()){
+			BlockDone.wait(Lock, [this]{ return InFlight.front()->Done; });
+			WriteBlock(*InFlight.front());
+			InFlight.pop_front();
+		}
+
+		Stopping = true;
+	}
+
+	WorkReady.notify_all();
+
+	for (unsigned n = 0; n < Workers.size(); ++n){
+		Workers[n].join();
+	}
+
+	Out.write(BgzfEOF, sizeof(BgzfEOF));
+	getStageCounters().BytesWritten += sizeof(BgzfEOF);
+	Out.flush();
+
+}
+
+void WriteBamHeader(BgzfWriter& Bam, const string& SampleID, const float ProgramVersion, const string& CommandLine){
+
+	string Header, Text;
+	ostringstream Version;
+
+	Version << ProgramVersion;
+
+	Text = "@HD\tVN:1.6\tSO:unsorted\n";
+	Text += "@RG\tID:" + SampleID + "\tSM:" + SampleID + "\n";
+	Text += "@PG\tID:RemoveAmpliconDuplicates\tPN:RemoveAmpliconDuplicates\tVN:" + Version.str() + "\tCL:" + CommandLine + "\n";
+
+	Header = "BAM\1";
+	AppendLittleEndian(Header, Text.length(), 4);
+	Header += Text;
+	AppendLittleEndian(Header, 0, 4); //n_ref
+
+	Bam.Write(Header.data(), Header.length());
+
+}
+
+void AppendBamStringTag(string& Tags, const char* Tag, const string& Value){
+
+	Tags.append(Tag, 2);
+	Tags += 'Z';
+	Tags += Value;
+	Tags += '\0';
+
+}
+
+void AppendBamIntTag(string& Tags, const char* Tag, const unsigned long Value){ //smallest unsigned type
+
+	Tags.append(Tag, 2);
+
+	if (Value <= UINT8_MAX){
+		Tags += 'C';
+		AppendLittleEndian(Tags, Value, 1);
+	} else if (Value <= UINT16_MAX){
+		Tags += 'S';
+		AppendLittleEndian(Tags, Value, 2);
+	} else {
+		Tags += 'I';
+		AppendLittleEndian(Tags, Value > UINT32_MAX ? UINT32_MAX : Value, 4);
+	}
+
+}
+
+void AppendBamFloatTag(string& Tags, const char* Tag, const float Value){
+
+	uint32_t Bits;
+
+	memcpy(&Bits, &Value, sizeof(Bits));
+
+	Tags.append(Tag, 2);
+	Tags += 'f';
+	AppendLittleEndian(Tags, Bits, 4);
+
+}
+
+void WriteBamRecord(BgzfWriter& Bam, const string& Header, const string& Seq, const string& Qual, const unsigned Flag,
+	const unsigned QScorePhredOffset, const string& Tags){
+
+	static const char SeqCodes[] = "=ACMGRSVTWYHKDBN";
+	static unsigned char BaseCodes[256] = { 0 };
+	static string Record; //reused; records are written from one thread
+
+	size_t NameStart = Header.length() > 0 && Header[0] == '@' ? 1 : 0;
+	size_t NameLen = min(Header.find_first_of(" \t", NameStart), Header.length()) - NameStart;
+	unsigned char Base;
+
+	if (BaseCodes['N'] == 0){
+		for (unsigned n = 0; n < 256; ++n){
+			BaseCodes[n] = 15;
+		}
+		for (unsigned n = 0; n < 16; ++n){
+			BaseCodes[(unsigned char) SeqCodes[n]] = n;
+		}
+	}
+
+	if (NameLen > 254){
+		NameLen = 254;
+	}
+
+	Record.clear();
+
+	AppendLittleEndian(Record, 0, 4); //block_size; set below
+	AppendLittleEndian(Record, UINT32_MAX, 4); //refID -1
+	AppendLittleEndian(Record, UINT32_MAX, 4); //pos -1
+	AppendLittleEndian(Record, NameLen + 1, 1);
+	AppendLittleEndian(Record, 0, 1); //mapq
+	AppendLittleEndian(Record, 4680, 2); //bin of an unplaced read
+	AppendLittleEndian(Record, 0, 2); //n_cigar_op
+	AppendLittleEndian(Record, Flag, 2);
+	AppendLittleEndian(Record, Seq.length(), 4);
+	AppendLittleEndian(Record, UINT32_MAX, 4); //next refID -1
+	AppendLittleEndian(Record, UINT32_MAX, 4); //next pos -1
+	AppendLittleEndian(Record, 0, 4); //tlen
+
+	Record.append(Header, NameStart, NameLen);
+	Record += '\0';
+
+	//4-bit bases, two per byte
+	for (size_t n = 0; n < Seq.length(); n += 2){
+
+		Base = BaseCodes[(unsigned char) Seq[n]] << 4;
+
+		if (n + 1 < Seq.length()){
+			Base |= BaseCodes[(unsigned char) Seq[n + 1]];
+		}
+
+		Record += (char) Base;
+	}
+
+	if (Qual.length() == Seq.length()){
+		for (size_t n = 0; n < Qual.length(); ++n){
+			Record += (char) (Qual[n] - QScorePhredOffset);
+		}
+	} else {
+		Record.append(Seq.length(), (char) 0xff);
+	}
+
+	Record += Tags;
+
+	//block_size excludes itself
+	string BlockSize;
+	AppendLittleEndian(BlockSize, Record.length() - 4, 4);
+	Record.replace(0, 4, BlockSize);
+
+	Bam.Write(Record.data(), Record.length());
+
+}
@@ -0,0 +1,66 @@
+/*
+* Filename : BamWriter.h
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : BGZF compressed unaligned BAM output; blocks are deflated on worker threads and written in order
+* Status: Release
+*/
+
+#pragma once
+
+#include <string>
+#include <ostream>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+class BgzfWriter {
+
+	public:
+
+		BgzfWriter(ostream& Out, const unsigned Threads); //Threads < 2 compresses on the calling thread
+		~BgzfWriter();
+
+		void Write(const char* Data, size_t Len); //records may span blocks
+		void Close(); //writes remaining blocks & the EOF marker
+
+	private:
+
+		typedef struct {
+			string Raw;
+			string Compressed;
+			bool Done;
+		} bgzfblock;
+
+		void SubmitBlock();
+		void WriteBlock(const bgzfblock& Block);
+		void CompressWorker();
+
+		ostream& Out;
+		string Pending; //uncompressed bytes of the current block
+		deque<shared_ptr<bgzfblock>> InFlight; //output order
+		deque<shared_ptr<bgzfblock>> Queue; //awaiting a worker
+		vector<thread> Workers;
+		mutex BlockMutex;
+		condition_variable WorkReady, BlockDone;
+		bool Stopping;
+		bool Closed;
+
+};
+
+	//@HD, one @RG per sample & @PG; no references
+	void WriteBamHeader(BgzfWriter& Bam, const string& SampleID, const float ProgramVersion, const string& CommandLine);
+
+	//aux fields are encoded once per molecule and shared by R1 & R2
+	void AppendBamStringTag(string& Tags, const char* Tag, const string& Value);
+	void AppendBamIntTag(string& Tags, const char* Tag, const unsigned long Value);
+	void AppendBamFloatTag(string& Tags, const char* Tag, const float Value);
+
+	//unmapped read; name is the FASTQ header up to the first space
+	void WriteBamRecord(BgzfWriter& Bam, const string& Header, const string& Seq, const string& Qual, const unsigned Flag,
+		const unsigned QScorePhredOffset, const string& Tags);
@@ -0,0 +1,101 @@
+/*
+* Filename : BuildBarcodeLookup.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Maps every index barcode within the allowed number of mismatches to its sample; ambiguous barcodes map to -1
+* Status: Release
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+void getBarcodeVariants(string& Barcode, const unsigned Start, const unsigned MismatchesLeft, vector<string>& Variants){
+
+	const char Bases[] = { 'A', 'C', 'G', 'T', 'N' };
+	char Original;
+
+	Variants.push_back(Barcode);
+
+	if (MismatchesLeft == 0){
+		return;
+	}
+
+	//substitute each remaining position in turn; index separator is never substituted
+	for (unsigned n = Start; n < Barcode.length(); ++n){
+
+		if (Barcode[n] == '+'){
+			continue;
+		}
+
+		Original = Barcode[n];
+
+		for (unsigned b = 0; b < 5; ++b){
+
+			if (Bases[b] == Original){
+				continue;
+			}
+
+			Barcode[n] = Bases[b];
+			getBarcodeVariants(Barcode, n + 1, MismatchesLeft - 1, Variants);
+		}
+
+		Barcode[n] = Original;
+	}
+
+	return;
+}
+
+bool BuildBarcodeLookup(const vector<samplesheetentry>& SampleSheet, const unsigned MaxBarcodeMismatches, unordered_map<string, int>& BarcodeLookup){ //return success or failure
+
+	int n;
+	string Barcode;
+	vector<string> Variants;
+	unordered_map<string, int> MismatchLookup;
+
+	//bank exact barcodes first; these always take priority over mismatched variants
+	for (n = 0; n < (int) SampleSheet.size(); ++n){
+
+		if (BarcodeLookup.count(SampleSheet[n].Barcode) == 1){
+			cerr << "ERROR: Duplicate index barcode in sample sheet: " << SampleSheet[n].Barcode << endl;
+			return 1;
+		}
+
+		BarcodeLookup[SampleSheet[n].Barcode] = n;
+	}
+
+	//bank mismatched variants; variants shared between samples cannot be assigned
+	for (n = 0; n < (int) SampleSheet.size(); ++n){
+
+		Variants.clear();
+		Barcode = SampleSheet[n].Barcode;
+		getBarcodeVariants(Barcode, 0, MaxBarcodeMismatches, Variants);
+
+		for (const string& Variant : Variants){
+
+			if (BarcodeLookup.count(Variant) == 1){
+				continue;
+			}
+
+			if (MismatchLookup.count(Variant) == 1 && MismatchLookup[Variant] != n){
+				MismatchLookup[Variant] = -1; //ambiguous
+			} else {
+				MismatchLookup[Variant] = n;
+			}
+
+		}
+
+	}
+
+	for (const auto& Variant : MismatchLookup){
+		if (Variant.second != -1){
+			BarcodeLookup.insert(Variant);
+		}
+	}
+
+	return 0;
+}
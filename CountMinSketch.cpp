@@ -0,0 +1,99 @@
+/*
+* Filename : CountMinSketch.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Approximate per-molecule frequency and best RTI quality used to identify molecules certain to fail RTIDepthErrorRateFilter
+* Status: Release
+*/
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <math.h>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+unsigned long long MixSketchHash(unsigned long long Hash){ //splitmix64 finaliser
+
+	Hash ^= Hash >> 30;
+	Hash *= 0xbf58476d1ce4e5b9ULL;
+	Hash ^= Hash >> 27;
+	Hash *= 0x94d049bb133111ebULL;
+	Hash ^= Hash >> 31;
+
+	return Hash;
+}
+
+unsigned long long getSketchHash(const unsigned SampleNo, const unsigned AmpliconNo, const string& RTI){
+	return MixSketchHash(hash<string>()(RTI) ^ ((unsigned long long) SampleNo << 40) ^ ((unsigned long long) AmpliconNo << 20));
+}
+
+void InitSketch(countminsketch& Sketch, const unsigned Depth, const unsigned long Width){
+
+	Sketch.Depth = Depth;
+	Sketch.Width = Width;
+	Sketch.Counts.assign(Depth * Width, 0);
+	Sketch.MaxRTIQScores.assign(Depth * Width, 0);
+
+	return;
+}
+
+void AddSketchKey(countminsketch& Sketch, const unsigned SampleNo, const unsigned AmpliconNo, const string& RTI, const unsigned RTIQScore){
+
+	unsigned long long Hash1 = getSketchHash(SampleNo, AmpliconNo, RTI), Hash2 = MixSketchHash(Hash1) | 1;
+	unsigned long Cell;
+	unsigned char MinCount = 255;
+
+	//conservative update; only the smallest counters are incremented
+	for (unsigned n = 0; n < Sketch.Depth; ++n){
+		Cell = n * Sketch.Width + ((Hash1 + n * Hash2) & (Sketch.Width - 1));
+
+		if (Sketch.Counts[Cell] < MinCount){
+			MinCount = Sketch.Counts[Cell];
+		}
+	}
+
+	for (unsigned n = 0; n < Sketch.Depth; ++n){
+		Cell = n * Sketch.Width + ((Hash1 + n * Hash2) & (Sketch.Width - 1));
+
+		if (Sketch.Counts[Cell] == MinCount && MinCount < 255){
+			Sketch.Counts[Cell]++; //saturates
+		}
+
+		if (RTIQScore > Sketch.MaxRTIQScores[Cell]){
+			Sketch.MaxRTIQScores[Cell] = RTIQScore;
+		}
+	}
+
+	return;
+}
+
+bool SketchCertainFail(const countminsketch& Sketch, const unsigned SampleNo, const unsigned AmpliconNo, const string& RTI, const unsigned MinRTIDepthErrorRate){
+
+	unsigned long long Hash1 = getSketchHash(SampleNo, AmpliconNo, RTI), Hash2 = MixSketchHash(Hash1) | 1;
+	unsigned long Cell;
+	unsigned char MaxFrequency = 255, MaxRTIQScore = 255;
+
+	for (unsigned n = 0; n < Sketch.Depth; ++n){
+		Cell = n * Sketch.Width + ((Hash1 + n * Hash2) & (Sketch.Width - 1));
+
+		if (Sketch.Counts[Cell] < MaxFrequency){
+			MaxFrequency = Sketch.Counts[Cell];
+		}
+
+		if (Sketch.MaxRTIQScores[Cell] < MaxRTIQScore){
+			MaxRTIQScore = Sketch.MaxRTIQScores[Cell];
+		}
+	}
+
+	if (MaxFrequency == 255){
+		return false; //saturated; frequency unknown
+	}
+
+	/*Frequency / (RTIErrors / Frequency) is at most Frequency / lowest RTI error rate of any read,
+	so molecules whose frequency upper bound is below MinRTIDepthErrorRate * lowest error rate cannot pass*/
+	double LowestErrorRate = (double)pow(10.00, (double)MaxRTIQScore / -10.00);
+
+	return MaxFrequency < MinRTIDepthErrorRate * LowestErrorRate * (1 - 1e-9);
+}
@@ -0,0 +1,648 @@
+/*
+* Filename : DedupEngine.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Matches, clips and collapses read pairs into molecules; filters and downsamples on request
+* Status: Release
+*/
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <random>
+#include <math.h>
+#include <DedupEngine.h>
+
+using namespace std;
+
+int RandomGenerator(int i) {
+
+	random_device rnd;
+	return rnd() % i;
+
+}
+
+DedupEngine::DedupEngine(const vector<amplicon>& Amplicons, const unordered_map<string, bool>& AmpliconStrand,
+	const dedupparameters& Parameters, const vector<sampledata>& Samples) :
+	Amplicons(Amplicons), AmpliconStrand(AmpliconStrand), Parameters(Parameters), Samples(Samples), Codec(), SketchPrepass(false),
+	UntimedCounters(), StageCounters(&UntimedCounters), Trace(false), PairsRead(0), UndeterminedReads(0), SkipPairs(0), Checkpoint(), CheckpointInterval(0) {
+
+	for (unsigned n = 0; n < Amplicons.size(); ++n){
+		ClipPrimers.push_back(ReverseComplement(Amplicons[n].RPrimer));
+		ClipPrimers.push_back(ReverseComplement(Amplicons[n].FPrimer));
+	}
+
+}
+
+void DedupEngine::ClipRightPrimer(string& Seq, string& Qual, const unsigned PrimerNo){
+
+	//a single exact copy of a primer of at least 10 bases is the best scoring local alignment, ending where the copy ends
+	size_t End = ClipPrimers[PrimerNo].length() >= 10 ? FindUniquePrimerEnd(Seq, ClipPrimers[PrimerNo]) : string::npos;
+	stagecounters& Counters = *StageCounters;
+
+	if (End == string::npos){
+		RightPrimerClipper(Seq, Qual, ClipPrimers[PrimerNo]);
+		Counters.AlignmentCalls++;
+		return;
+	}
+
+	Seq.resize(End);
+	Qual.resize(min(End, Qual.length()));
+	Counters.ExactClips++;
+
+}
+
+void DedupEngine::EnableInstrumentation(stagecounters& Counters, const bool Trace){
+
+	StageCounters = &Counters;
+	this->Trace = Trace;
+
+}
+
+void DedupEngine::EndSpan(const char* Name, const unsigned long long StartNs, const unsigned long long Arg) const {
+
+	if (Trace == true){
+		AddTraceSpan(Name, StartNs, Arg);
+	}
+
+}
+
+void DedupEngine::EnableSketchPrepass(const unsigned Depth, const unsigned long Width){
+
+	InitSketch(Sketch, Depth, Width);
+	SketchPrepass = true;
+	ReservoirRandom.seed(random_device()());
+
+	//a molecule is proven to fail only below MinRTIDepthErrorRate x the error rate of its best RTI, which RTIQfilter caps at MinRTIBaseQScore
+	if (Parameters.MinRTIDepthErrorRate * pow(10.00, (double)Parameters.MinRTIBaseQScore / -10.00) <= 1){
+		cerr << "WARNING: No molecule can be proven to fail RTIDepthErrorRateFilter; the sketch pre-pass only sizes the downsampling reservoirs." << endl;
+	}
+
+}
+
+void DedupEngine::RestrictAmplicons(const vector<bool>& Included){
+	IncludedAmplicons = Included;
+}
+
+void DedupEngine::OnUsableRead(const function<void(const readpairview& ReadPair, const unsigned AmpliconNo, const string& RTI)>& Callback){
+	UsableReadCallback = Callback;
+}
+
+void DedupEngine::OnBatch(const function<void(const unsigned Pass)>& Callback){
+	BatchCallback = Callback;
+}
+
+void DedupEngine::EnableCheckpoints(const string& CheckpointfN, const unsigned long Interval, const function<bool(vector<unsigned long>&)>& RTIHeadersOffsets){
+
+	this->CheckpointfN = CheckpointfN;
+	CheckpointInterval = Interval;
+	RTIHeadersOffsetsCallback = RTIHeadersOffsets;
+
+}
+
+void DedupEngine::MatchBatch(const vector<readpairview>& Batch, const bool SketchPass){ //read pairs are not counted until they are aggregated
+
+	const unsigned TrimLen = Parameters.RTILen + Parameters.AntiComplementaryRegionLen;
+
+	unsigned n;
+	unsigned long long ReadStartNs, TraceStartNs = SpanStart();
+	stagecounters& Counters = *StageCounters;
+
+	if (Counters.AmpliconReads.size() < Amplicons.size()){
+		Counters.AmpliconReads.resize(Amplicons.size());
+		Counters.AmpliconReadNs.resize(Amplicons.size());
+	}
+
+	if (Work.size() < Batch.size()){
+		Work.resize(Batch.size());
+	}
+
+	for (unsigned b = 0; b < Batch.size(); ++b) {
+
+		const readpairview& View = Batch[b];
+		readpair& ReadPair = Work[b];
+
+		ReadPair.Status = UnmatchedPair;
+		ReadStartNs = Counters.LapNs;
+
+		if (View.SeqR1 == "NNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNN" || View.SeqR2 == "NNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNN"){
+			ReadPair.Status = NMaskedPair;
+			continue;
+		}
+
+		//Check if RTI consists of Qx bases
+		if (RTIQfilter(View.QualR1, Parameters.RTILen, Parameters.QScorePhredOffset, Parameters.MinRTIBaseQScore) == false ||
+			RTIQfilter(View.QualR2, Parameters.RTILen, Parameters.QScorePhredOffset, Parameters.MinRTIBaseQScore) == false){
+			ReadPair.Status = RTIQualityPair;
+			continue; //skip counters with any bases less than minQscore
+		}
+
+		//Define RTI
+		ReadPair.RTI = string(View.SeqR1.substr(0, Parameters.RTILen)) + ReverseComplement(string(View.SeqR2.substr(0, Parameters.RTILen)));
+		ReadPair.RTIQualities = string(View.QualR1.substr(0, Parameters.RTILen)) + string(View.QualR2.substr(0, Parameters.RTILen));
+
+		//Trim RTI; the primer kernels need contiguous strings
+		ReadPair.SeqR1.assign(View.SeqR1.substr(min<size_t>(TrimLen, View.SeqR1.length())));
+		ReadPair.SeqR2.assign(View.SeqR2.substr(min<size_t>(TrimLen, View.SeqR2.length())));
+		ReadPair.QualR1.assign(View.QualR1.substr(min<size_t>(TrimLen, View.QualR1.length())));
+		ReadPair.QualR2.assign(View.QualR2.substr(min<size_t>(TrimLen, View.QualR2.length())));
+
+		LapStage(Counters, ParseStage);
+
+		//Iterate over amplicons
+		for (n = 0; n < Amplicons.size(); ++n) {
+
+			Counters.AlignmentCalls++;
+
+			if (MatchPrimer(ReadPair.SeqR1, Amplicons[n].FPrimer) == 1) { //local alignment
+
+				Counters.AlignmentCalls++;
+
+				if (MatchPrimer(ReadPair.SeqR2, Amplicons[n].RPrimer) == 1) { //read matches to this amplicon
+
+					LapStage(Counters, MatchStage);
+
+					if (IncludesAmplicon(n) == false){ //another shard's amplicon; not clipped or counted here
+						ReadPair.Status = ExcludedAmpliconPair;
+						break;
+					}
+
+					if (SketchPass == true){ //sketch molecule frequency and best RTI quality only
+						ReadPair.Status = PrimerMatchedPair;
+						break;
+					}
+
+					//Trim adapter and right RTI from read
+					ClipRightPrimer(ReadPair.SeqR1, ReadPair.QualR1, n * 2);
+					ClipRightPrimer(ReadPair.SeqR2, ReadPair.QualR2, n * 2 + 1);
+
+					LapStage(Counters, ClipStage);
+
+					//Reduce primer dimer; insert size less than MinInsertLength ignored
+					if (ReadPair.SeqR1.length() > Amplicons[n].FPrimerLen + Amplicons[n].RPrimerLen + Parameters.MinInsertSize &&
+						ReadPair.SeqR2.length() > Amplicons[n].FPrimerLen + Amplicons[n].RPrimerLen + Parameters.MinInsertSize) {
+						ReadPair.Status = UsablePair;
+					} else { //?length greater than the sum of both primers
+						ReadPair.Status = ShortInsertPair;
+					}
+
+				}//?reverse primer mataches
+
+				break; //if forward primer is found dont count this read again
+
+			} //?forward primer matches
+
+		} //end iterating over amplicons
+
+		ReadPair.AmpliconNo = n;
+		LapStage(Counters, MatchStage);
+
+		if (SketchPass == false && n < Amplicons.size()){
+			Counters.AmpliconReadNs[n] += Counters.LapNs - ReadStartNs;
+		}
+
+	}
+
+	EndSpan("match/clip", TraceStartNs, Batch.size());
+
+}
+
+void DedupEngine::PushSketchBatch(const vector<readpairview>& Batch){
+
+	MatchBatch(Batch, true);
+
+	SketchRTIs.resize(Samples.size(), vector<unordered_set<string>>(Amplicons.size()));
+
+	for (unsigned b = 0; b < Batch.size(); ++b) {
+
+		if (Work[b].Status == PrimerMatchedPair){
+			AddSketchKey(Sketch, Batch[b].SampleNo, Work[b].AmpliconNo, Work[b].RTI,
+				*min_element(Work[b].RTIQualities.begin(), Work[b].RTIQualities.end()) - Parameters.QScorePhredOffset);
+			SketchRTIs[Batch[b].SampleNo][Work[b].AmpliconNo].insert(Work[b].RTI);
+		}
+
+	}
+
+}
+
+void DedupEngine::EndSketchPass(){
+
+	unsigned long Molecules = 0, CertainFails = 0;
+
+	DownsampleBounds.assign(Samples.size(), vector<unsigned long>(Amplicons.size(), 0));
+
+	//molecules that may pass bound the molecules that do, and so the downsampled reads written per amplicon
+	for (unsigned s = 0; s < SketchRTIs.size(); ++s){
+		for (unsigned a = 0; a < SketchRTIs[s].size(); ++a){
+			for (const string& RTI : SketchRTIs[s][a]){
+				if (SketchCertainFail(Sketch, s, a, RTI, Parameters.MinRTIDepthErrorRate) == false){
+					DownsampleBounds[s][a]++;
+				} else {
+					CertainFails++;
+				}
+				Molecules++;
+			}
+		}
+	}
+
+	StageCounters->SketchMolecules += Molecules;
+	StageCounters->SketchCertainFails += CertainFails;
+
+	//only molecules whose every read has a low quality RTI base can be proven to fail
+	if (Molecules > 0 && CertainFails * 100 < Molecules){
+		cerr << "WARNING: The sketch pre-pass proved " << CertainFails << " of " << Molecules << " molecules fail RTIDepthErrorRateFilter; read bodies are stored for the rest." << endl;
+	}
+
+	vector<vector<unordered_set<string>>>().swap(SketchRTIs);
+
+}
+
+void DedupEngine::PushBatch(const vector<readpairview>& Batch){
+
+	unsigned n;
+	unsigned long long ReadStartNs, TraceStartNs;
+	double ReadErrors, RTIErrors;
+	size_t Fingerprint;
+	packedheader Header;
+	unfilteredread TempUnfilteredRead;
+	bool Duplicate, CertainFail, Pooled;
+	size_t Slot;
+	stagecounters& Counters = *StageCounters;
+
+	if (SketchPrepass == true && DownsampleBounds.empty() == true){
+		EndSketchPass();
+	}
+
+	MatchBatch(Batch, false);
+
+	TraceStartNs = SpanStart();
+
+	//update counters & molecule tables in input order
+	for (unsigned b = 0; b < Batch.size(); ++b) {
+
+		const readpairview& View = Batch[b];
+		readpair& ReadPair = Work[b];
+		sampledata& Sample = Samples[View.SampleNo];
+
+		Sample.TotalPairedReads++;
+
+		if (ReadPair.Status == NMaskedPair){
+			Sample.NMaskedReads++;
+			continue;
+		} else if (ReadPair.Status == RTIQualityPair){
+			Sample.RTIQualityDiscardedReads++;
+			continue;
+		} else if (ReadPair.Status == UnmatchedPair || ReadPair.Status == ExcludedAmpliconPair){
+			continue;
+		}
+
+		Sample.PrimerMatchedReads++;
+
+		if (ReadPair.Status == ShortInsertPair){
+			Sample.LenDiscardedReads++;
+			continue;
+		}
+
+		ReadStartNs = Counters.LapNs;
+		n = ReadPair.AmpliconNo;
+
+		Sample.AmpliconUsableReads[Amplicons[n].AmpliconID]++;
+		Sample.TotalUsableReads++;
+
+		//headers are stored as shared prefix & comment plus per-read coordinates; held by this read until stored
+		Header = EncodeHeaders(Codec, View.HeaderR1, View.HeaderR2);
+
+		//byte-identical to the molecule's best read: same ReadErrors, so only the counts change
+		Fingerprint = getReadBodyFingerprint(ReadPair.SeqR1, ReadPair.SeqR2, ReadPair.QualR1, ReadPair.QualR2);
+		unordered_map<string, molecule>& AmpliconReads = Sample.Reads[Amplicons[n].AmpliconID];
+		auto Molecule = AmpliconReads.find(ReadPair.RTI);
+		Counters.HashProbes += 2; //amplicon table then RTI
+		Duplicate = Molecule != AmpliconReads.end() && Molecule->second.Body != NULL &&
+			IsSameReadBody(*Molecule->second.Body, ReadPair.SeqR1, ReadPair.SeqR2, ReadPair.QualR1, ReadPair.QualR2, Fingerprint);
+
+		//molecule cannot pass RTIDepthErrorRateFilter; it keeps counts without a read body
+		CertainFail = Duplicate == false && SketchPrepass == true && SketchCertainFail(Sketch, View.SampleNo, n, ReadPair.RTI, Parameters.MinRTIDepthErrorRate);
+
+		//reads for downsampling; after a sketch pass a reservoir no larger than the molecules that may pass
+		vector<unfilteredread>& Pool = Sample.UnfilteredReads[Amplicons[n].AmpliconID];
+		Slot = Pool.size();
+		Pooled = true;
+
+		if (DownsampleBounds.empty() == false && Pool.size() >= DownsampleBounds[View.SampleNo][n]){
+			Slot = uniform_int_distribution<unsigned long>(0, Sample.AmpliconUsableReads[Amplicons[n].AmpliconID] - 1)(ReservoirRandom);
+			Pooled = Slot < Pool.size();
+		}
+
+		//identical pairs share the stored body; a body neither the pool nor the molecule keeps is not built
+		TempUnfilteredRead.Header = Header;
+
+		if (Duplicate == true){
+			TempUnfilteredRead.Body = Molecule->second.Body;
+		} else if (Pooled == true || CertainFail == false){
+			TempUnfilteredRead.Body = MakeReadBody(ReadPair.SeqR1, ReadPair.SeqR2, ReadPair.QualR1, ReadPair.QualR2, Fingerprint,
+				Parameters.QScorePhredOffset, Parameters.QualityBins);
+		} else {
+			TempUnfilteredRead.Body.reset();
+		}
+
+		if (Pooled == true && Slot == Pool.size()){
+			Pool.push_back(TempUnfilteredRead);
+			RetainHeader(Codec, Header);
+		} else if (Pooled == true){
+			ReleaseHeader(Codec, Pool[Slot].Header);
+			Pool[Slot] = TempUnfilteredRead;
+			RetainHeader(Codec, Header);
+		}
+
+		LapStage(Counters, HashStage);
+
+		//e.g. read headers associated with each RTI
+		if (UsableReadCallback){
+			UsableReadCallback(View, n, ReadPair.RTI);
+		}
+
+		LapStage(Counters, OutputStage);
+
+		//Calculate number of readErrors across both reads & RTI
+		RTIErrors = getHighestErrorRate(ReadPair.RTIQualities, Parameters.QScorePhredOffset);
+
+		if (Duplicate == true){
+
+			Molecule->second.Frequency++;
+			Molecule->second.RTIErrors += RTIErrors;
+
+			LapStage(Counters, ErrorScoreStage);
+			Counters.DuplicateReads++;
+
+		} else {
+
+			ReadErrors = CalcReadErrorRate(ReadPair.QualR1, Parameters.QScorePhredOffset) + CalcReadErrorRate(ReadPair.QualR2, Parameters.QScorePhredOffset);
+
+			LapStage(Counters, ErrorScoreStage);
+
+			//counts only; otherwise check if this RTI has been seen before
+			if (CertainFail == true){
+
+				molecule& Counts = AmpliconReads[ReadPair.RTI];
+				Counts.Frequency++;
+				Counts.RTIErrors += RTIErrors;
+				Counts.PrintRead = true;
+
+				Counters.HashProbes++;
+
+			} else if (Molecule != AmpliconReads.end()){ //amplicon:RTI = molecule
+
+				if (Molecule->second.ReadErrors > ReadErrors){ //overwrite old read with new read containing less readErrors
+
+					//overwrite with new record
+					ReleaseHeader(Codec, Molecule->second.Header);
+					Molecule->second = MakeTempRead(Header, TempUnfilteredRead.Body, ReadErrors, Molecule->second.RTIErrors + RTIErrors, Molecule->second.Frequency + 1); //increase RTI frequency
+					RetainHeader(Codec, Header);
+
+				} else {
+					Molecule->second.Frequency++; //retain current record but increase frequency
+					Molecule->second.RTIErrors += RTIErrors; //retain current record but increase RTIErrors
+				}
+
+			} else { //not seen before
+
+				//bank new record
+				AmpliconReads[ReadPair.RTI] = MakeTempRead(Header, TempUnfilteredRead.Body, ReadErrors, RTIErrors, 1);
+				RetainHeader(Codec, Header);
+
+				Counters.HashProbes++;
+			}
+
+		}
+
+		//duplicates & counts-only molecules keep no header
+		ReleaseHeader(Codec, Header);
+
+		LapStage(Counters, HashStage);
+
+		//time from the end of parsing to the molecule table update
+		Counters.AmpliconReads[n]++;
+		Counters.AmpliconReadNs[n] += Counters.LapNs - ReadStartNs;
+
+	}
+
+	EndSpan("aggregate", TraceStartNs, Batch.size());
+
+}
+
+bool DedupEngine::ProcessInput(FastqPairReader& Input, const unsigned BatchSize){
+
+	unsigned Pass, BatchLen;
+	int Status, SampleNo;
+	bool CheckpointDue;
+	unsigned long BatchNo = 0;
+	unsigned long long TraceStartNs;
+	vector<fastqpair> Records(BatchSize);
+	vector<readpairview> Views;
+	stagecounters& Counters = *StageCounters;
+
+	Checkpoint.R1fN = Input.getName();
+	Checkpoint.Complete = false;
+	Checkpoint.QualityBins = Parameters.QualityBins;
+	Checkpoint.PairsProcessed = SkipPairs;
+
+	Counters.LapNs = StageClock(Counters);
+
+	//optional first pass approximates molecule counts before any read bodies are stored
+	for (Pass = SketchPrepass ? 0 : 1; Pass < 2; ++Pass) {
+
+		Status = 1;
+
+		while (Status == 1) {
+
+			TraceStartNs = SpanStart();
+			BatchLen = 0;
+			CheckpointDue = false;
+			Views.clear();
+
+			//end the batch where a checkpoint is due
+			while (BatchLen < BatchSize && CheckpointDue == false) {
+
+				fastqpair& Record = Records[BatchLen];
+
+				Status = Input.ReadPair(Record, Counters.BytesRead);
+
+				if (Status != 1){
+					break;
+				}
+
+				PairsRead++;
+
+				//due even if this pair is skipped or undetermined
+				CheckpointDue = CheckpointfN != "" && CheckpointInterval > 0 && PairsRead % CheckpointInterval == 0 && PairsRead > SkipPairs;
+
+				if (PairsRead <= SkipPairs){
+					continue; //already in the molecule tables
+				}
+
+				SampleNo = Input.getSampleNo(Record);
+
+				if (SampleNo == -1){
+					UndeterminedReads++;
+					continue;
+				}
+
+				Views.push_back({ Record.HeaderR1, Record.HeaderR2, Record.SeqR1, Record.SeqR2, Record.QualR1, Record.QualR2, (unsigned) SampleNo, Checkpoint.EarlierPairs + PairsRead });
+				BatchLen++; //record is held by the view until the batch is pushed
+
+			} //finished reading batch
+
+			if (Status == -1){
+				return 1;
+			}
+
+			LapStage(Counters, ParseStage);
+			EndSpan("parse", TraceStartNs, BatchNo);
+
+			if (Pass == 0){
+				PushSketchBatch(Views);
+			} else {
+				PushBatch(Views);
+			}
+
+			BatchNo++;
+
+			if (BatchCallback){
+				BatchCallback(Pass);
+			}
+
+			//save molecule tables every CheckpointInterval paired reads
+			if (CheckpointDue == true && SaveCheckpoint(false) == 1){
+				return 1;
+			}
+
+		} //finished reading input
+
+		if (Pass == 0){
+
+			//discard first pass counts
+			if (Input.Rewind() == 1){
+				return 1;
+			}
+
+			PairsRead = 0;
+			UndeterminedReads = 0;
+		}
+
+	} //finished passes
+
+	LapStage(Counters, ParseStage);
+
+	//save unfiltered molecule tables for top-up runs
+	if (CheckpointfN != "" && SaveCheckpoint(true) == 1){
+		return 1;
+	}
+
+	return 0;
+}
+
+void DedupEngine::FinalizeAmplicon(const unsigned SampleNo, const unsigned AmpliconNo){
+
+	unsigned long long StartNs, TraceStartNs;
+	sampledata& Sample = Samples[SampleNo];
+	stagecounters& Counters = *StageCounters;
+
+	if (Finalized.size() < Samples.size()){
+		Finalized.resize(Samples.size());
+	}
+
+	if (Finalized[SampleNo].size() < Amplicons.size()){
+		Finalized[SampleNo].resize(Amplicons.size(), false);
+	}
+
+	if (Finalized[SampleNo][AmpliconNo] == true){
+		return;
+	}
+
+	Finalized[SampleNo][AmpliconNo] = true;
+
+	auto Amplicon = Sample.Reads.find(Amplicons[AmpliconNo].AmpliconID);
+
+	if (Amplicon == Sample.Reads.end()){
+		return;
+	}
+
+	StartNs = StageClock(Counters);
+
+	//Remove RTIs with low depth / error rate score
+	TraceStartNs = SpanStart();
+	RTIDepthErrorRateFilter(Amplicon->second, Parameters.MinRTIDepthErrorRate);
+	LapStage(Counters, DepthFilterStage);
+	EndSpan("RTIDepthErrorRateFilter", TraceStartNs, AmpliconNo);
+
+	//Remove RTIs with an edit distance less than MinRTIEditDistance --highest frequency RTIs will be prioritised
+	TraceStartNs = SpanStart();
+	FilterRTIsbyEditDistance(Amplicon->second, Parameters.MinRTIEditDistance);
+	LapStage(Counters, EditDistanceFilterStage);
+	EndSpan("FilterRTIsbyEditDistance", TraceStartNs, AmpliconNo);
+
+	if (Counters.Timed == true){
+		Counters.AmpliconFilterNs[Amplicon->first] += Counters.LapNs - StartNs;
+	}
+
+	//count passing molecules; sets the downsampling depth
+	for (const auto & Read : Amplicon->second){
+
+		if (Read.second.PrintRead == true){
+			Sample.TotalUsableMolecules++;
+			Sample.AmpliconUniqueReads[Amplicon->first]++;
+		}
+
+	}
+
+}
+
+void DedupEngine::Finalize(){
+
+	for (unsigned n = 0; n < Samples.size(); ++n){
+		for (unsigned a = 0; a < Amplicons.size(); ++a){
+			FinalizeAmplicon(n, a);
+		}
+	}
+
+}
+
+void DedupEngine::ForEachMolecule(const unsigned SampleNo, const unsigned AmpliconNo, const function<void(const string& RTI, const molecule& Molecule)>& Callback){
+
+	auto Amplicon = Samples[SampleNo].Reads.find(Amplicons[AmpliconNo].AmpliconID);
+
+	if (Amplicon == Samples[SampleNo].Reads.end()){
+		return;
+	}
+
+	for (const auto & Read : Amplicon->second){ //RTI = molecule
+
+		if (Read.second.PrintRead == true){
+			Callback(Read.first, Read.second);
+		}
+
+	}
+
+}
+
+void DedupEngine::ForEachDownsampledRead(const unsigned SampleNo, const unsigned AmpliconNo, const function<void(const unfilteredread& Read)>& Callback){
+
+	sampledata& Sample = Samples[SampleNo];
+	auto Amplicon = Sample.UnfilteredReads.find(Amplicons[AmpliconNo].AmpliconID);
+
+	if (Amplicon == Sample.UnfilteredReads.end()){
+		return;
+	}
+
+	//randomly shuffle unfiltered paired reads
+	random_shuffle(Amplicon->second.begin(), Amplicon->second.end(), RandomGenerator);
+
+	//select the first n reads giving the same depth per amplicon as filtered
+	for (unsigned n = 0; n < Sample.AmpliconUniqueReads[Amplicon->first] && n < Amplicon->second.size(); ++n){
+		Callback(Amplicon->second[n]);
+	}
+
+}
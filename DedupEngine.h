@@ -0,0 +1,147 @@
+/*
+* Filename : DedupEngine.h
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Embeddable read pair deduplication: push read pair batches, finalize, then visit selected molecules and downsampled reads
+* Status: Release
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <random>
+#include <RemoveAmpliconDuplicates.h>
+#include <FastqPairReader.h>
+
+using namespace std;
+
+//read pair held by the caller; the views only need to stay valid for the PushBatch call
+	typedef struct {
+		string_view HeaderR1;
+		string_view HeaderR2;
+		string_view SeqR1;
+		string_view SeqR2;
+		string_view QualR1;
+		string_view QualR2;
+		unsigned SampleNo; //index into the engine's samples
+		unsigned long Ordinal; //read pair number in the input; top-ups continue from the checkpointed inputs
+	} readpairview;
+
+	typedef struct {
+		unsigned RTILen; //Random template identifier
+		unsigned AntiComplementaryRegionLen;
+		unsigned MinRTIBaseQScore;
+		unsigned MinRTIEditDistance;
+		unsigned QScorePhredOffset;
+		unsigned MaxQScore;
+		unsigned MinInsertSize;
+		unsigned MinRTIDepthErrorRate;
+		bool QualityBins; //stored qualities binned after ReadErrors is scored
+	} dedupparameters;
+
+	//outcome of matching one read pair; applied to the molecule tables in input order
+	enum pairstatus { NMaskedPair, RTIQualityPair, UnmatchedPair, PrimerMatchedPair, ShortInsertPair, UsablePair, ExcludedAmpliconPair };
+
+	typedef struct {
+		string SeqR1; //RTI & spacer trimmed, then clipped
+		string SeqR2;
+		string QualR1;
+		string QualR2;
+		pairstatus Status;
+		unsigned AmpliconNo;
+		string RTI;
+		string RTIQualities;
+	} readpair;
+
+class DedupEngine {
+
+	public:
+
+		//Samples names the samples read pairs are routed to; their counters & molecule tables start empty
+		DedupEngine(const vector<amplicon>& Amplicons, const unordered_map<string, bool>& AmpliconStrand,
+			const dedupparameters& Parameters, const vector<sampledata>& Samples);
+
+		//stage timings & counters are charged to Counters, timed if Counters.Timed is set; spans are recorded with Trace
+		void EnableInstrumentation(stagecounters& Counters, const bool Trace);
+
+		//molecules the count-min sketch proves will fail RTIDepthErrorRateFilter keep counts only, and downsampling
+		//keeps a reservoir per amplicon no larger than its molecules that may pass
+		void EnableSketchPrepass(const unsigned Depth, const unsigned long Width);
+		void PushSketchBatch(const vector<readpairview>& Batch);
+
+		//read pairs of other amplicons are matched so every amplicon keeps its first-match reads, then dropped uncounted
+		void RestrictAmplicons(const vector<bool>& Included);
+		bool IncludesAmplicon(const unsigned AmpliconNo) const { return IncludedAmplicons.empty() || IncludedAmplicons[AmpliconNo]; }
+
+		void PushBatch(const vector<readpairview>& Batch);
+		void OnUsableRead(const function<void(const readpairview& ReadPair, const unsigned AmpliconNo, const string& RTI)>& Callback);
+
+		//checkpoints every Interval read pairs (0 = none) & after the input; RTIHeadersOffsets gives the bytes of RTI headers written per sample, returning success or failure
+		void EnableCheckpoints(const string& CheckpointfN, const unsigned long Interval, const function<bool(vector<unsigned long>&)>& RTIHeadersOffsets);
+		bool RestoreCheckpoint(const string& CheckpointfN, const string& R1fN, vector<unsigned long>& RTIHeadersOffsets); //return success or failure
+
+		//reads the input in batches, twice with the sketch pre-pass; read pairs already in a restored checkpoint are skipped
+		bool ProcessInput(FastqPairReader& Input, const unsigned BatchSize); //return success or failure
+		void OnBatch(const function<void(const unsigned Pass)>& Callback); //e.g. progress
+
+		//runs RTIDepthErrorRateFilter & FilterRTIsbyEditDistance and counts unique molecules
+		void Finalize();
+		void FinalizeAmplicon(const unsigned SampleNo, const unsigned AmpliconNo); //one amplicon may be written while others are filtered
+
+		//molecules passing the filters; call after Finalize or FinalizeAmplicon
+		void ForEachMolecule(const unsigned SampleNo, const unsigned AmpliconNo, const function<void(const string& RTI, const molecule& Molecule)>& Callback);
+
+		//random unfiltered reads at the same depth as the selected molecules; call after Finalize or FinalizeAmplicon
+		void ForEachDownsampledRead(const unsigned SampleNo, const unsigned AmpliconNo, const function<void(const unfilteredread& Read)>& Callback);
+
+		const vector<amplicon>& getAmplicons() const { return Amplicons; }
+		const unordered_map<string, bool>& getAmpliconStrand() const { return AmpliconStrand; }
+		const dedupparameters& getParameters() const { return Parameters; }
+		const vector<sampledata>& getSamples() const { return Samples; } //stats & molecule tables
+		const headercodec& getCodec() const { return Codec; }
+		unsigned long getPairsRead() const { return PairsRead; } //this run's input, skipped pairs included
+		unsigned long getUndeterminedReads() const { return UndeterminedReads; }
+
+	private:
+
+		void MatchBatch(const vector<readpairview>& Batch, const bool SketchPass);
+		void ClipRightPrimer(string& Seq, string& Qual, const unsigned PrimerNo); //unique exact hit first, RightPrimerClipper otherwise
+		void EndSketchPass(); //sizes the downsampling reservoirs from the complete sketch
+		bool SaveCheckpoint(const bool Complete); //return success or failure
+		unsigned long long SpanStart() const { return Trace == true ? TraceClock() : 0; }
+		void EndSpan(const char* Name, const unsigned long long StartNs, const unsigned long long Arg) const;
+
+		vector<amplicon> Amplicons;
+		unordered_map<string, bool> AmpliconStrand;
+		dedupparameters Parameters;
+		vector<sampledata> Samples;
+		headercodec Codec;
+		bool SketchPrepass;
+		countminsketch Sketch;
+		vector<vector<unordered_set<string>>> SketchRTIs; //sample, amplicon; distinct RTIs of the sketch pass
+		vector<vector<unsigned long>> DownsampleBounds; //sample, amplicon; reservoir size; empty = every read is kept
+		mt19937_64 ReservoirRandom;
+		vector<bool> IncludedAmplicons; //empty = all
+		vector<readpair> Work; //per batch; reused to keep string capacity
+		vector<string> ClipPrimers; //amplicon x 2: reverse complemented RPrimer (R1) then FPrimer (R2)
+		vector<vector<bool>> Finalized; //sample, amplicon
+		function<void(const readpairview&, const unsigned, const string&)> UsableReadCallback;
+		function<void(const unsigned)> BatchCallback;
+		stagecounters UntimedCounters; //used until instrumentation is enabled
+		stagecounters* StageCounters;
+		bool Trace;
+		unsigned long PairsRead;
+		unsigned long UndeterminedReads;
+		unsigned long SkipPairs; //read pairs of a part way checkpoint
+		checkpointinfo Checkpoint;
+		string CheckpointfN;
+		unsigned long CheckpointInterval;
+		function<bool(vector<unsigned long>&)> RTIHeadersOffsetsCallback;
+
+};
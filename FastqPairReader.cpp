@@ -0,0 +1,96 @@
+/*
+* Filename : FastqPairReader.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Reads paired FASTQ records with optional index reads and routes each pair to its sample by barcode
+* Status: Release
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <FastqPairReader.h>
+
+using namespace std;
+
+FastqPairReader::FastqPairReader(const string& R1fN, istream& R1In, istream& R2In, istream* I1In, istream* I2In) :
+	R1fN(R1fN), R1In(R1In), R2In(R2In), I1In(I1In), I2In(I2In), Demultiplex(false), Index1Len(0), Index2Len(0), CheckedHeaders(0) {}
+
+bool FastqPairReader::setSampleSheet(const vector<samplesheetentry>& SampleSheet, const unsigned MaxBarcodeMismatches){
+
+	if (BuildBarcodeLookup(SampleSheet, MaxBarcodeMismatches, BarcodeLookup) == 1){
+		return 1;
+	}
+
+	Index1Len = SampleSheet[0].Barcode.find('+') == string::npos ? SampleSheet[0].Barcode.length() : SampleSheet[0].Barcode.find('+');
+	Index2Len = SampleSheet[0].Barcode.length() == Index1Len ? 0 : SampleSheet[0].Barcode.length() - Index1Len - 1;
+	Demultiplex = true;
+
+	return 0;
+}
+
+int FastqPairReader::ReadPair(fastqpair& Record, unsigned long long& BytesRead){
+
+	//interleaved input holds R1 then R2 of each pair
+	if (getFastqRecord(R1In, Record.HeaderR1, Record.SeqR1, Record.QualR1, BytesRead) == false ||
+		getFastqRecord(R2In, Record.HeaderR2, Record.SeqR2, Record.QualR2, BytesRead) == false){
+		return 0;
+	}
+
+	if (I1In != NULL && getFastqRecord(*I1In, IndexHeader, Record.Barcode, IndexQual, BytesRead) == false){
+		return 0;
+	}
+
+	if (I2In != NULL && getFastqRecord(*I2In, IndexHeader, Index2Seq, IndexQual, BytesRead) == false){
+		return 0;
+	} else if (I2In != NULL){
+		Record.Barcode += '+' + Index2Seq;
+	}
+
+	if (CheckedHeaders < 10){ //Check header hamming distance equals 1
+
+		if (Record.HeaderR1.length() != Record.HeaderR2.length() || getHammingDistance(Record.HeaderR1, Record.HeaderR2) != 1){
+			cerr << "ERROR: Read header hamming distance does not equal one. Check FASTQ input." << endl;
+			return -1;
+		}
+
+		CheckedHeaders++;
+	}
+
+	return 1;
+}
+
+int FastqPairReader::getSampleNo(fastqpair& Record) const {
+
+	if (Demultiplex == false){
+		return 0;
+	}
+
+	if (I1In == NULL){
+		Record.Barcode = getHeaderBarcode(Record.HeaderR1);
+	}
+
+	return getBarcodeSample(BarcodeLookup, Record.Barcode, Index1Len, Index2Len);
+}
+
+bool FastqPairReader::Rewind(){
+
+	for (istream* In : { &R1In, &R2In, I1In, I2In }){
+
+		if (In == NULL){
+			continue;
+		}
+
+		In->clear();
+		In->seekg(0);
+
+		if (In->fail()){
+			cerr << "ERROR: Unable to rewind " << R1fN << " for a second pass." << endl;
+			return 1;
+		}
+
+	}
+
+	return 0;
+}
@@ -0,0 +1,49 @@
+/*
+* Filename : FastqPairReader.h
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Reads paired FASTQ records with optional index reads and routes each pair to its sample by barcode
+* Status: Release
+*/
+
+#pragma once
+
+#include <string>
+#include <istream>
+#include <vector>
+#include <unordered_map>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+class FastqPairReader {
+
+	public:
+
+		//R1 & R2 may be one interleaved stream; index reads are read in lockstep when given
+		FastqPairReader(const string& R1fN, istream& R1In, istream& R2In, istream* I1In, istream* I2In);
+
+		//without a sample sheet every pair belongs to sample 0
+		bool setSampleSheet(const vector<samplesheetentry>& SampleSheet, const unsigned MaxBarcodeMismatches); //return success or failure
+
+		int ReadPair(fastqpair& Record, unsigned long long& BytesRead); //1 = read, 0 = end of input, -1 = malformed input
+		int getSampleNo(fastqpair& Record) const; //-1 = undetermined
+		bool Rewind(); //return success or failure
+
+		const string& getName() const { return R1fN; } //identifies the input in checkpoints
+
+	private:
+
+		string R1fN;
+		istream& R1In;
+		istream& R2In;
+		istream* I1In;
+		istream* I2In;
+		bool Demultiplex;
+		unordered_map<string, int> BarcodeLookup; //barcode = sample number
+		unsigned Index1Len;
+		unsigned Index2Len;
+		unsigned CheckedHeaders;
+		string IndexHeader, IndexQual, Index2Seq;
+
+};
@@ -7,50 +7,58 @@
 */
 
 #include <unordered_map>
+#include <vector>
 #include <RemoveAmpliconDuplicates.h>
 
 using namespace std;
 
-void FilterRTIsbyEditDistance(unordered_map<string, unordered_map<string, molecule>> & Reads, const unsigned MinRTIEditDistance){ //amplicon, RTI, molecule
+void FilterRTIsbyEditDistance(unordered_map<string, molecule> & RTIs, const unsigned MinRTIEditDistance){ //RTI, molecule of one amplicon
 
 	unsigned HammingDistance;
+	vector<PackedSequence> PackedRTIs;
+	vector<molecule*> Molecules;
 
-	//iterate over amplicons with usable reads
-	for (auto & Amplicon : Reads){
+	//pack once; compared pairwise below in map order
+	PackedRTIs.reserve(RTIs.size());
+	Molecules.reserve(RTIs.size());
 
-		//iterate over RTIs associated with this amplicon
-		for (auto & OuterRead : Amplicon.second){
+	for (auto & Read : RTIs){
+		PackedRTIs.push_back(PackedSequence(Read.first));
+		Molecules.push_back(&Read.second);
+	}
 
-			//skip over RTIs that will not be printed
-			if (OuterRead.second.PrintRead == false){
-				continue;
-			}
+	//iterate over RTIs associated with this amplicon
+	for (size_t Outer = 0; Outer < PackedRTIs.size(); ++Outer){
 
-			//iterate back over over RTIs associated with this amplicon
-			for (auto & InnerRead : Amplicon.second){
+		//skip over RTIs that will not be printed
+		if (Molecules[Outer]->PrintRead == false){
+			continue;
+		}
 
-				//skip over RTIs that will not be printed
-				if (InnerRead.second.PrintRead == false){
-					continue;
-				}
+		//iterate back over over RTIs associated with this amplicon
+		for (size_t Inner = 0; Inner < PackedRTIs.size(); ++Inner){
 
-				//calculate edit distance
-				HammingDistance = getHammingDistance(OuterRead.first, InnerRead.first);
+			//skip over RTIs that will not be printed
+			if (Molecules[Inner]->PrintRead == false){
+				continue;
+			}
 
-				if (HammingDistance != 0 && HammingDistance < MinRTIEditDistance){ //too similar discard RTI
+			//calculate edit distance
+			HammingDistance = getHammingDistance(PackedRTIs[Outer], PackedRTIs[Inner]);
 
-					//retain highest frequency RTI
-					if (OuterRead.second.Frequency > InnerRead.second.Frequency){
-						InnerRead.second.PrintRead = false; // this record will not be printed
-					} else {
-						OuterRead.second.PrintRead = false; // this record will not be printed
-					}
+			if (HammingDistance != 0 && HammingDistance < MinRTIEditDistance){ //too similar discard RTI
 
+				//retain highest frequency RTI
+				if (Molecules[Outer]->Frequency > Molecules[Inner]->Frequency){
+					Molecules[Inner]->PrintRead = false; // this record will not be printed
+				} else {
+					Molecules[Outer]->PrintRead = false; // this record will not be printed
 				}
 
 			}
 
 		}
+
 	}
 
 	return;
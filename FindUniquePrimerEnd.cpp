@@ -0,0 +1,24 @@
+/*
+* Filename : FindUniquePrimerEnd.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : A unique exact copy of a reverse complemented primer gives the same clip as RightPrimerClipper without an alignment
+* Status: Release
+*/
+
+#include <string>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+//one primer is searched per read, so a plain find is used rather than a multi-pattern automaton
+size_t FindUniquePrimerEnd(const string& Seq, const string& Primer){ //string::npos unless the primer occurs exactly once
+
+	size_t Start = Seq.find(Primer);
+
+	if (Start == string::npos || Seq.find(Primer, Start + 1) != string::npos){
+		return string::npos; //absent or repeated; the aligner decides
+	}
+
+	return Start + Primer.length();
+}
@@ -0,0 +1,141 @@
+/*
+* Filename : HeaderCodec.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Stores paired Illumina 1.8+ read headers as shared prefix & comment entries plus lane, tile, x and y; rebuilt at output
+* Status: Release
+*/
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+bool getHeaderCoordinate(string_view Field, unsigned long& Value){ //digits only; must print back identically
+
+	if (Field.empty() || Field.length() > 9 || (Field[0] == '0' && Field.length() > 1)){
+		return false;
+	}
+
+	Value = 0;
+
+	for (unsigned n = 0; n < Field.length(); ++n){
+
+		if (Field[n] < '0' || Field[n] > '9'){
+			return false;
+		}
+
+		Value = Value * 10 + (Field[n] - '0');
+	}
+
+	return true;
+}
+
+packedheader EncodeHeaders(headercodec& Codec, string_view HeaderR1, string_view HeaderR2){
+
+	packedheader Header;
+	size_t CommentPosR1 = HeaderR1.find(' '), CommentPosR2 = HeaderR2.find(' '), FieldPos, NextPos;
+	string_view NameR1 = HeaderR1.substr(0, CommentPosR1);
+	string Prefix, Comment;
+	unsigned long Coordinates[4];
+	unsigned n;
+
+	//@instrument:run:flowcell:lane:tile:x:y; read names must agree and only the comments differ
+	bool Illumina = NameR1 == HeaderR2.substr(0, CommentPosR2);
+
+	for (n = 0, FieldPos = 0; n < 3 && Illumina; ++n){
+		FieldPos = NameR1.find(':', FieldPos);
+		Illumina = FieldPos != string::npos;
+		FieldPos++;
+	}
+
+	for (n = 0; n < 4 && Illumina; ++n){
+		NextPos = NameR1.find(':', FieldPos);
+		Illumina = (n == 3) == (NextPos == string::npos) && getHeaderCoordinate(NameR1.substr(FieldPos, NextPos - FieldPos), Coordinates[n]);
+		FieldPos = NextPos + 1;
+	}
+
+	if (Illumina == false || Coordinates[0] == 0 || Coordinates[0] > 65535){
+
+		//keep both headers as they are, in a released slot pair if there is one
+		Header.Lane = 0;
+
+		if (Codec.FreeVerbatim.empty() == false){
+			Header.Prefix = Codec.FreeVerbatim.back();
+			Codec.FreeVerbatim.pop_back();
+			Codec.Verbatim[Header.Prefix] = HeaderR1;
+			Codec.Verbatim[Header.Prefix + 1] = HeaderR2;
+			Codec.VerbatimRefs[Header.Prefix / 2] = 1;
+		} else {
+			Header.Prefix = Codec.Verbatim.size();
+			Codec.Verbatim.push_back(string(HeaderR1));
+			Codec.Verbatim.push_back(string(HeaderR2));
+			Codec.VerbatimRefs.push_back(1);
+		}
+
+		Header.Comment = Header.Prefix + 1;
+
+		return Header;
+	}
+
+	Header.Lane = Coordinates[0];
+	Header.Tile = Coordinates[1];
+	Header.X = Coordinates[2];
+	Header.Y = Coordinates[3];
+
+	//shared instrument:run:flowcell prefix
+	Prefix = string(NameR1.substr(0, NameR1.find(':', NameR1.find(':', NameR1.find(':') + 1) + 1) + 1));
+
+	unordered_map<string, unsigned>::iterator Entry = Codec.PrefixLookup.find(Prefix);
+
+	if (Entry == Codec.PrefixLookup.end()){
+		Entry = Codec.PrefixLookup.insert(make_pair(Prefix, (unsigned) Codec.Prefixes.size())).first;
+		Codec.Prefixes.push_back(Prefix);
+	}
+
+	Header.Prefix = Entry->second;
+
+	//shared comments, e.g. " 1:N:0:BARCODE" & " 2:N:0:BARCODE"
+	Comment = string(CommentPosR1 == string::npos ? "" : HeaderR1.substr(CommentPosR1)) + '\n' + string(CommentPosR2 == string::npos ? "" : HeaderR2.substr(CommentPosR2));
+
+	Entry = Codec.CommentLookup.find(Comment);
+
+	if (Entry == Codec.CommentLookup.end()){
+		Entry = Codec.CommentLookup.insert(make_pair(Comment, (unsigned) Codec.CommentsR1.size())).first;
+		Codec.CommentsR1.push_back(string(CommentPosR1 == string::npos ? "" : HeaderR1.substr(CommentPosR1)));
+		Codec.CommentsR2.push_back(string(CommentPosR2 == string::npos ? "" : HeaderR2.substr(CommentPosR2)));
+	}
+
+	Header.Comment = Entry->second;
+
+	return Header;
+}
+
+void RetainHeader(headercodec& Codec, const packedheader& Header){
+
+	if (Header.Lane == 0){
+		Codec.VerbatimRefs[Header.Prefix / 2]++;
+	}
+
+}
+
+void ReleaseHeader(headercodec& Codec, const packedheader& Header){
+
+	if (Header.Lane == 0 && --Codec.VerbatimRefs[Header.Prefix / 2] == 0){
+		Codec.FreeVerbatim.push_back(Header.Prefix);
+	}
+
+}
+
+string DecodeHeader(const headercodec& Codec, const packedheader& Header, const unsigned ReadNo){
+
+	if (Header.Lane == 0){
+		return Codec.Verbatim[ReadNo == 1 ? Header.Prefix : Header.Comment];
+	}
+
+	return Codec.Prefixes[Header.Prefix] + to_string(Header.Lane) + ':' + to_string(Header.Tile) + ':' + to_string(Header.X) + ':' + to_string(Header.Y) +
+		(ReadNo == 1 ? Codec.CommentsR1[Header.Comment] : Codec.CommentsR2[Header.Comment]);
+}
@@ -0,0 +1,317 @@
+/*
+* Filename : KernelBenchmark.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Times the per-read kernels on synthetic reads and optionally compares against a saved baseline
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <unordered_map>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+typedef struct {
+	vector<string> Seqs;
+	vector<string> Quals;
+	vector<string> Others; //primer, mate or comparison sequence
+	vector<string> OtherQuals;
+} benchmarkinput;
+
+const unsigned PoolSize = 64; //inputs cycled per case
+const unsigned QScorePhredOffset = 33, MaxQScore = 40;
+
+mt19937 Rng(20150601);
+double MinSeconds = 0.2;
+string Filter;
+unordered_map<string, double> Baseline; //kernel & case = ns per call
+volatile unsigned long Sink; //keeps results live
+
+string RandomSeq(const unsigned Len){
+
+	const char Bases[] = { 'A', 'C', 'G', 'T' };
+	string Seq(Len, 'A');
+
+	for (unsigned n = 0; n < Len; ++n){
+		Seq[n] = Bases[Rng() % 4];
+	}
+
+	return Seq;
+}
+
+string RandomQual(const unsigned Len){
+
+	string Qual(Len, 'I');
+
+	//mostly high quality with a degrading tail
+	for (unsigned n = 0; n < Len; ++n){
+		Qual[n] = QScorePhredOffset + (Rng() % 100 < 80 + (n * 15) / Len ? 30 + Rng() % 11 : 2 + Rng() % 28);
+	}
+
+	return Qual;
+}
+
+string Mutate(string Seq, const string& Mix){ //exact, 2mm (two substitutions) or 1indel
+
+	const char Bases[] = { 'A', 'C', 'G', 'T' };
+	unsigned Pos;
+
+	if (Mix == "2mm"){
+		for (unsigned n = 0; n < 2; ++n){
+			Pos = 1 + Rng() % (Seq.length() - 4); //keep the 3' end anchored
+			Seq[Pos] = Bases[(string("ACGT").find(Seq[Pos]) + 1 + Rng() % 3) % 4];
+		}
+	} else if (Mix == "1indel"){
+		Pos = 1 + Rng() % (Seq.length() - 4);
+
+		if (Rng() % 2 == 0){
+			Seq.erase(Pos, 1);
+		} else {
+			Seq.insert(Pos, 1, Bases[Rng() % 4]);
+		}
+	}
+
+	return Seq;
+}
+
+template <typename Kernel> void RunKernel(const string& KernelName, const string& Case, const unsigned long BasesPerCall, Kernel Call){
+
+	if (Filter != "" && (KernelName + '/' + Case).find(Filter) == string::npos){
+		return;
+	}
+
+	unsigned long Calls = 0, Batch = 16;
+	double Seconds = 0;
+	chrono::steady_clock::time_point Start = chrono::steady_clock::now();
+
+	//warm up then double the batch until the minimum time is reached
+	for (unsigned n = 0; n < PoolSize; ++n){
+		Call(n);
+	}
+
+	Start = chrono::steady_clock::now();
+
+	while (Seconds < MinSeconds){
+
+		for (unsigned long n = 0; n < Batch; ++n){
+			Call((Calls + n) % PoolSize);
+		}
+
+		Calls += Batch;
+		Batch *= 2;
+		Seconds = chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+	}
+
+	double NsPerCall = Seconds * 1e9 / Calls;
+
+	cout << KernelName << "\t" << Case << "\t" << Calls << "\t" << NsPerCall << "\t" << (BasesPerCall * Calls) / Seconds;
+
+	if (Baseline.count(KernelName + "\t" + Case) == 1){
+		cout << "\t" << Baseline[KernelName + "\t" + Case] << "\t" << ((NsPerCall / Baseline[KernelName + "\t" + Case]) - 1) * 100 << "%";
+	}
+
+	cout << endl;
+}
+
+bool getBaseline(const string& BaselinefN){ //return success or failure
+
+	string Line, Kernel, Case, Calls, NsPerCall;
+	ifstream BaselineIn(BaselinefN.c_str());
+
+	if (!BaselineIn.is_open()){
+		cerr << "ERROR: Unable to open baseline file" << endl;
+		return 1;
+	}
+
+	while (getline(BaselineIn, Line)){
+
+		if (Line == "" || Line.compare(0, 6, "Kernel") == 0){
+			continue;
+		}
+
+		istringstream Fields(Line);
+		getline(Fields, Kernel, '\t');
+		getline(Fields, Case, '\t');
+		getline(Fields, Calls, '\t');
+		getline(Fields, NsPerCall, '\t');
+
+		Baseline[Kernel + "\t" + Case] = atof(NsPerCall.c_str());
+	}
+
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+
+	const unsigned ReadLens[] = { 150, 250, 300 };
+	const unsigned PrimerLens[] = { 18, 24, 30 };
+	const string Mixes[] = { "exact", "2mm", "1indel" };
+
+	string Option;
+	unsigned n;
+
+	for (int i = 1; i < argc; ++i){
+
+		Option = argv[i];
+
+		if (Option == "--baseline" && i + 1 < argc){
+			if (getBaseline(argv[++i]) == 1){
+				return -1;
+			}
+		} else if (Option == "--min-time" && i + 1 < argc){
+			MinSeconds = atof(argv[++i]);
+		} else if (Option == "--filter" && i + 1 < argc){
+			Filter = argv[++i];
+		} else {
+			cerr << "\nProgram: KernelBenchmark" << endl;
+			cerr << "Contact: Matthew Lyon, WRGL/UoS (mlyon@live.co.uk)\n" << endl;
+			cerr << "Usage: KernelBenchmark [--baseline <previous output>] [--min-time <seconds per case>] [--filter <kernel/case substring>]\n" << endl;
+			return -1;
+		}
+
+	}
+
+	cout << "Kernel\tCase\tCalls\tNsPerCall\tBasesPerSec";
+
+	if (Baseline.size() > 0){
+		cout << "\tBaselineNsPerCall\tChange";
+	}
+
+	cout << endl;
+
+	for (unsigned ReadLen : ReadLens){
+
+		benchmarkinput Input;
+		string Len = to_string(ReadLen) + "bp";
+
+		for (n = 0; n < PoolSize; ++n){
+			Input.Seqs.push_back(RandomSeq(ReadLen));
+			Input.Quals.push_back(RandomQual(ReadLen));
+			Input.Others.push_back(Mutate(Input.Seqs[n], "2mm"));
+		}
+
+		RunKernel("ReverseComplement", Len, ReadLen, [&](unsigned i){ Sink += ReverseComplement(Input.Seqs[i]).length(); });
+		RunKernel("CalcReadErrorRate", Len, ReadLen, [&](unsigned i){ Sink += CalcReadErrorRate(Input.Quals[i], QScorePhredOffset) * 1e6; });
+		RunKernel("getHighestErrorRate", Len, ReadLen, [&](unsigned i){ Sink += getHighestErrorRate(Input.Quals[i], QScorePhredOffset) * 1e6; });
+		RunKernel("getHammingDistance", Len, ReadLen, [&](unsigned i){ Sink += getHammingDistance(Input.Seqs[i], Input.Others[i]); });
+
+		//2 bit packed read bodies
+		vector<PackedSequence> Packed, PackedOthers;
+
+		for (n = 0; n < PoolSize; ++n){
+			Packed.push_back(PackedSequence(Input.Seqs[n]));
+			PackedOthers.push_back(PackedSequence(Input.Others[n]));
+		}
+
+		RunKernel("PackSequence", Len, ReadLen, [&](unsigned i){ Sink += PackedSequence(Input.Seqs[i]).length(); });
+		RunKernel("PackedReverseComplement", Len, ReadLen, [&](unsigned i){ Sink += Packed[i].ReverseComplement().length(); });
+		RunKernel("PackedHammingDistance", Len, ReadLen, [&](unsigned i){ Sink += getHammingDistance(Packed[i], PackedOthers[i]); });
+
+	}
+
+	//random template identifiers
+	{
+		benchmarkinput Input;
+
+		for (n = 0; n < PoolSize; ++n){
+			Input.Seqs.push_back(RandomSeq(10));
+			Input.Others.push_back(RandomSeq(10));
+		}
+
+		RunKernel("getHammingDistance", "RTI10bp", 10, [&](unsigned i){ Sink += getHammingDistance(Input.Seqs[i], Input.Others[i]); });
+
+		vector<PackedSequence> Packed, PackedOthers;
+
+		for (n = 0; n < PoolSize; ++n){
+			Packed.push_back(PackedSequence(Input.Seqs[n]));
+			PackedOthers.push_back(PackedSequence(Input.Others[n]));
+		}
+
+		RunKernel("PackedHammingDistance", "RTI10bp", 10, [&](unsigned i){ Sink += getHammingDistance(Packed[i], PackedOthers[i]); });
+	}
+
+	//primer matching & clipping
+	for (unsigned ReadLen : ReadLens){
+		for (unsigned PrimerLen : PrimerLens){
+			for (const string& Mix : Mixes){
+
+				benchmarkinput Match, Clip;
+				string Case = to_string(ReadLen) + "bp/primer" + to_string(PrimerLen) + "/" + Mix, Primer;
+
+				for (n = 0; n < PoolSize; ++n){
+
+					//forward primer at the start of the trimmed read
+					Primer = RandomSeq(PrimerLen);
+					Match.Others.push_back(Primer);
+					Match.Seqs.push_back((Mutate(Primer, Mix) + RandomSeq(ReadLen)).substr(0, ReadLen));
+
+					//readthrough into the reverse complemented opposite primer and adapter
+					Primer = RandomSeq(PrimerLen);
+					Clip.Others.push_back(Primer);
+					Clip.Seqs.push_back((RandomSeq(ReadLen * 3 / 5) + Mutate(Primer, Mix) + RandomSeq(ReadLen)).substr(0, ReadLen));
+					Clip.Quals.push_back(RandomQual(ReadLen));
+				}
+
+				RunKernel("MatchPrimer", Case, ReadLen, [&](unsigned i){ Sink += MatchPrimer(Match.Seqs[i], Match.Others[i]); });
+				RunKernel("RightPrimerClipper", Case, ReadLen, [&](unsigned i){
+
+					//clipping is destructive; the copy is included in the timing
+					string Seq = Clip.Seqs[i], Qual = Clip.Quals[i];
+					RightPrimerClipper(Seq, Qual, Clip.Others[i]);
+					Sink += Seq.length();
+				});
+
+				//as DedupEngine clips: unique exact hits first, alignment otherwise
+				RunKernel("ExactPrimerClipper", Case, ReadLen, [&](unsigned i){
+
+					string Seq = Clip.Seqs[i], Qual = Clip.Quals[i];
+					size_t End = FindUniquePrimerEnd(Seq, Clip.Others[i]);
+
+					if (End == string::npos){
+						RightPrimerClipper(Seq, Qual, Clip.Others[i]);
+					} else {
+						Seq.resize(End);
+						Qual.resize(End);
+					}
+
+					Sink += Seq.length();
+				});
+
+			}
+		}
+	}
+
+	//overlapping pairs from fragments 1.6x the read length
+	for (unsigned ReadLen : ReadLens){
+		for (const string& Mix : Mixes){
+
+			benchmarkinput Input;
+			string Fragment;
+
+			for (n = 0; n < PoolSize; ++n){
+				Fragment = RandomSeq(ReadLen * 8 / 5);
+				Input.Seqs.push_back(Mutate(Fragment.substr(0, ReadLen), Mix));
+				Input.Quals.push_back(RandomQual(Input.Seqs[n].length()));
+				Input.Others.push_back(Mutate(ReverseComplement(Fragment).substr(0, ReadLen), Mix));
+				Input.OtherQuals.push_back(RandomQual(Input.Others[n].length()));
+			}
+
+			RunKernel("ReadMerger", to_string(ReadLen) + "bp/" + Mix, ReadLen * 2, [&](unsigned i){
+
+				pair<string, string> MergedRead;
+				Sink += ReadMerger(Input.Seqs[i], Input.Quals[i], Input.Others[i], Input.OtherQuals[i], MaxQScore, QScorePhredOffset, MergedRead);
+			});
+
+		}
+	}
+
+	return 0;
+}
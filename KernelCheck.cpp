@@ -0,0 +1,103 @@
+/*
+* Filename : KernelCheck.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Checks the SIMD & packed reverse complement and hamming distance kernels against scalar references; run by ctest
+* Status: Release
+*/
+
+#include <iostream>
+#include <string>
+#include <random>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+//ACGT, ACGTN, both cases, then characters the SIMD blocks must hand back to the scalar loop
+const char Chars[] = { 'A', 'C', 'G', 'T', 'N', 'a', 'c', 'g', 't', 'n', 'R', '.' };
+const unsigned Alphabets[] = { 4, 5, 10, 12 };
+const unsigned MaxLen = 320; //every length across the 16 & 32 base blocks of read lengths
+
+mt19937 Rng(1);
+
+string RandomSeq(const unsigned Len, const unsigned Alphabet){
+
+	string Seq(Len, 'A');
+
+	for (unsigned n = 0; n < Len; ++n){
+		Seq[n] = Chars[Rng() % Alphabet];
+	}
+
+	return Seq;
+}
+
+bool CheckReverseComplement(){ //return success or failure
+
+	string Seq, RevComp[2], PackedRevComp[2];
+
+	for (unsigned Len = 0; Len <= MaxLen; ++Len){
+		for (unsigned Alphabet : Alphabets){
+
+			Seq = RandomSeq(Len, Alphabet);
+
+			RevComp[0] = ReverseComplement(Seq);
+			RevComp[1] = ScalarReverseComplement(Seq);
+			PackedRevComp[0] = PackedSequence(Seq).ReverseComplement().ToString();
+			PackedRevComp[1] = PackedSequence(Seq).ScalarReverseComplement().ToString();
+
+			if (RevComp[0] != RevComp[1] || PackedRevComp[0] != PackedRevComp[1] || PackedRevComp[0] != RevComp[0]){
+				cerr << "ERROR: SSSE3 and scalar reverse complements differ for " << Seq << endl;
+				return 1;
+			}
+
+		}
+	}
+
+	return 0;
+}
+
+bool CheckHammingDistance(){ //return success or failure
+
+	const unsigned Substitutions[] = { 0, 1, 2, 8, MaxLen }; //up to, per pair
+	string Seq, Other;
+	unsigned Expected;
+
+	for (unsigned Len = 0; Len <= MaxLen; ++Len){
+		for (unsigned Alphabet : Alphabets){
+			for (unsigned MaxSubstitutions : Substitutions){
+
+				Seq = RandomSeq(Len, Alphabet);
+				Other = Seq;
+
+				for (unsigned n = 0; n < MaxSubstitutions && Len > 0; ++n){
+					Other[Rng() % Len] = Chars[Rng() % Alphabet];
+				}
+
+				Expected = 0;
+
+				for (unsigned n = 0; n < Len; ++n){
+					if (Seq[n] != Other[n]){
+						Expected++;
+					}
+				}
+
+				if (getHammingDistance(Seq, Other) != Expected || getHammingDistance(PackedSequence(Seq), PackedSequence(Other)) != Expected){
+					cerr << "ERROR: Hamming distance kernels differ from a base by base count for " << Seq << " & " << Other << endl;
+					return 1;
+				}
+
+			}
+		}
+	}
+
+	return 0;
+}
+
+int main() {
+
+	if (CheckReverseComplement() == 1 || CheckHammingDistance() == 1){
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,356 @@
+/*
+* Filename : MergeShards.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Assigns amplicons to shards and combines the outputs of --shard runs into those of an unsharded run
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <unordered_map>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+typedef struct {
+	unordered_map<string, unsigned long> Counters; //name = value
+	unordered_map<string, vector<unsigned long>> Amplicons; //AmpliconID = UsableReads, UniqueReads, Dedupped records, Trimmed records
+} shardsummary;
+
+unsigned getAmpliconShard(const string& AmpliconID, const unsigned ShardCount){ //FNV-1a; zero based
+
+	unsigned long long Hash = 0xcbf29ce484222325ULL;
+
+	for (const char c : AmpliconID){
+		Hash ^= (unsigned char) c;
+		Hash *= 0x100000001b3ULL;
+	}
+
+	return Hash % ShardCount;
+}
+
+static bool ReadShardSummary(const string& SummaryfN, shardsummary& Summary){ //return success or failure
+
+	ifstream SummaryIn(SummaryfN.c_str());
+	string Name, AmpliconID;
+	unsigned long Value;
+
+	if (!SummaryIn.is_open()){
+		cerr << "ERROR: Unable to open " << SummaryfN << endl;
+		return 1;
+	}
+
+	while (SummaryIn >> Name){
+
+		if (Name == "Amplicon"){
+
+			vector<unsigned long> Counts(4);
+
+			SummaryIn >> AmpliconID >> Counts[0] >> Counts[1] >> Counts[2] >> Counts[3];
+			Summary.Amplicons[AmpliconID] = Counts;
+
+		} else if (SummaryIn >> Value){
+			Summary.Counters[Name] = Value;
+		}
+
+	}
+
+	if (!SummaryIn.eof()){
+		cerr << "ERROR: " << SummaryfN << " is malformed." << endl;
+		return 1;
+	}
+
+	for (const char* Name : { "UndeterminedReads", "TotalPairedReads", "NMaskedReads", "RTIQualityDiscardedReads",
+		"PrimerMatchedReads", "LenDiscardedReads", "TotalUsableReads", "TotalUsableMolecules" }){
+		if (Summary.Counters.count(Name) == 0){
+			cerr << "ERROR: " << SummaryfN << " has no " << Name << " count." << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static bool CopyLines(istream& In, ostream& Out, const unsigned long Lines){ //return success or failure
+
+	string Line;
+
+	for (unsigned long n = 0; n < Lines; ++n){
+
+		if (!getline(In, Line)){
+			return 1;
+		}
+
+		Out << Line << "\n";
+	}
+
+	return 0;
+}
+
+static bool getShardedRTIHeader(istream& In, unsigned long long& Ordinal, string& Line){ //ordinal then the unsharded line
+
+	string Tagged;
+	size_t Tab;
+
+	if (!getline(In, Tagged) || (Tab = Tagged.find('\t')) == string::npos){
+		return false;
+	}
+
+	Ordinal = strtoull(Tagged.c_str(), NULL, 10);
+	Line = Tagged.substr(Tab + 1);
+
+	return true;
+}
+
+int MergeShards(int argc, char* argv[]){
+
+	unsigned ShardCount = 0, n, s;
+	string SampleSheetfN, Line;
+	vector<amplicon> Amplicons;
+	unordered_map<string, bool> AmpliconStrand;
+	vector<samplesheetentry> SampleSheet;
+	vector<sampledata> Samples;
+	sampledata TempSample = sampledata();
+	vector<unsigned> AmpliconShards;
+
+	//RemoveAmpliconDuplicates merge <AmpliconList> <R1.fastq> <R2.fastq> --shards <N> [--samplesheet <file>]
+	for (int a = 5; a + 1 < argc; a += 2){
+
+		if (string(argv[a]) == "--shards"){
+			ShardCount = atoi(argv[a + 1]);
+		} else if (string(argv[a]) == "--samplesheet"){
+			SampleSheetfN = argv[a + 1];
+		} else {
+			cerr << "ERROR: Unknown merge option " << argv[a] << endl;
+			return -1;
+		}
+
+	}
+
+	if (argc < 7 || argc % 2 == 0 || ShardCount == 0){
+		cerr << "Usage: RemoveAmpliconDuplicates merge <AmpliconList> <R1.fastq> <R2.fastq> --shards <N> [--samplesheet <file>]" << endl;
+		cerr << "Give the amplicons, FASTQs and sample sheet the --shard runs were given; writes the outputs of an unsharded run." << endl;
+		return -1;
+	}
+
+	string AmpliconfN = argv[2], R1fN = argv[3], R2fN = argv[4];
+	ifstream AmpliconsIn(AmpliconfN.c_str());
+
+	if (getAmplicons(AmpliconsIn, Amplicons, AmpliconStrand) == 1){
+		return -1;
+	}
+
+	for (n = 0; n < Amplicons.size(); ++n){
+		AmpliconShards.push_back(getAmpliconShard(Amplicons[n].AmpliconID, ShardCount));
+	}
+
+	//output stems as the shard runs derived them, before tagging
+	if (SampleSheetfN == ""){
+
+		TempSample.SampleID = getSampleID(R1fN);
+		TempSample.R1fN = R1fN;
+		TempSample.R2fN = R2fN;
+		TempSample.StatsPrefix = R1fN.substr(0, R1fN.find_first_of('_'));
+		Samples.push_back(TempSample);
+
+	} else {
+
+		ifstream SamplesIn(SampleSheetfN.c_str());
+		string OutputDir = R1fN.substr(0, R1fN.find_last_of('/') + 1);
+
+		if (getSamples(SamplesIn, SampleSheet) == 1){
+			return -1;
+		}
+
+		for (n = 0; n < SampleSheet.size(); ++n){
+			TempSample.SampleID = SampleSheet[n].SampleID;
+			TempSample.R1fN = OutputDir + SampleSheet[n].SampleID + "_R1.fastq";
+			TempSample.R2fN = OutputDir + SampleSheet[n].SampleID + "_R2.fastq";
+			TempSample.StatsPrefix = OutputDir + SampleSheet[n].SampleID;
+			Samples.push_back(TempSample);
+		}
+
+	}
+
+	for (unsigned SampleNo = 0; SampleNo < Samples.size(); ++SampleNo){
+
+		sampledata& Sample = Samples[SampleNo];
+		vector<shardsummary> Summaries(ShardCount);
+		vector<string> ShardTags;
+
+		for (s = 0; s < ShardCount; ++s){
+
+			ShardTags.push_back(".Shard" + to_string(s + 1) + "of" + to_string(ShardCount));
+
+			if (ReadShardSummary(Sample.StatsPrefix + ShardTags[s] + "_Summary.txt", Summaries[s]) == 1){
+				return -1;
+			}
+
+		}
+
+		//every shard parsed the whole input; matched reads are counted by the shard owning their amplicon
+		for (s = 0; s < ShardCount; ++s){
+
+			for (const char* Global : { "UndeterminedReads", "TotalPairedReads", "NMaskedReads", "RTIQualityDiscardedReads" }){
+				if (Summaries[s].Counters.at(Global) != Summaries[0].Counters.at(Global)){
+					cerr << "ERROR: " << Sample.StatsPrefix << ShardTags[s] << " was run on different input to " << Sample.StatsPrefix << ShardTags[0] << endl;
+					return -1;
+				}
+			}
+
+			for (const auto & Counts : Summaries[s].Amplicons){
+				if (AmpliconStrand.count(Counts.first) == 0 || getAmpliconShard(Counts.first, ShardCount) != s){
+					cerr << "ERROR: " << Sample.StatsPrefix << ShardTags[s] << " holds amplicon " << Counts.first << " of another shard; check --shards." << endl;
+					return -1;
+				}
+			}
+
+			Sample.PrimerMatchedReads += Summaries[s].Counters.at("PrimerMatchedReads");
+			Sample.LenDiscardedReads += Summaries[s].Counters.at("LenDiscardedReads");
+			Sample.TotalUsableReads += Summaries[s].Counters.at("TotalUsableReads");
+			Sample.TotalUsableMolecules += Summaries[s].Counters.at("TotalUsableMolecules");
+		}
+
+		Sample.TotalPairedReads = Summaries[0].Counters.at("TotalPairedReads");
+		Sample.NMaskedReads = Summaries[0].Counters.at("NMaskedReads");
+		Sample.RTIQualityDiscardedReads = Summaries[0].Counters.at("RTIQualityDiscardedReads");
+
+		if (SampleSheetfN != "" && SampleNo == 0){
+			cout << "\nUndeterminedPairedReads: " << Summaries[0].Counters.at("UndeterminedReads") << endl;
+		}
+
+		if (SampleSheetfN != ""){
+			cout << "\nSampleID: " << Sample.SampleID << endl;
+		}
+
+		//shard inputs & unsharded outputs
+		vector<unique_ptr<ifstream>> ShardDedupped, ShardTrimmed, ShardStats, ShardRTIHeaders;
+		ofstream Dedupped[2][2], Trimmed[2][2], StatsOut, RTIHeadersOut;
+
+		for (s = 0; s < ShardCount; ++s){
+			for (unsigned Strand = 0; Strand < 2; ++Strand){
+				ShardDedupped.emplace_back(new ifstream((Sample.R1fN + ShardTags[s] + ".Dedupped_" + to_string(Strand) + ".fastq").c_str()));
+				ShardDedupped.emplace_back(new ifstream((Sample.R2fN + ShardTags[s] + ".Dedupped_" + to_string(Strand) + ".fastq").c_str()));
+				ShardTrimmed.emplace_back(new ifstream((Sample.R1fN + ShardTags[s] + ".Trimmed_" + to_string(Strand) + ".fastq").c_str()));
+				ShardTrimmed.emplace_back(new ifstream((Sample.R2fN + ShardTags[s] + ".Trimmed_" + to_string(Strand) + ".fastq").c_str()));
+			}
+
+			ShardStats.emplace_back(new ifstream((Sample.StatsPrefix + ShardTags[s] + "_RTIs.txt").c_str()));
+			ShardRTIHeaders.emplace_back(new ifstream((Sample.StatsPrefix + ShardTags[s] + "_RTIHeaders.txt").c_str()));
+		}
+
+		for (const auto & In : { &ShardDedupped, &ShardTrimmed, &ShardStats, &ShardRTIHeaders }){
+			for (const auto & File : *In){
+				if (!File->is_open()){
+					cerr << "ERROR: Unable to open the outputs of every shard for " << Sample.SampleID << endl;
+					return -1;
+				}
+			}
+		}
+
+		for (unsigned Strand = 0; Strand < 2; ++Strand){
+			Dedupped[Strand][0].open((Sample.R1fN + ".Dedupped_" + to_string(Strand) + ".fastq").c_str(), ios::binary);
+			Dedupped[Strand][1].open((Sample.R2fN + ".Dedupped_" + to_string(Strand) + ".fastq").c_str(), ios::binary);
+			Trimmed[Strand][0].open((Sample.R1fN + ".Trimmed_" + to_string(Strand) + ".fastq").c_str(), ios::binary);
+			Trimmed[Strand][1].open((Sample.R2fN + ".Trimmed_" + to_string(Strand) + ".fastq").c_str(), ios::binary);
+		}
+
+		StatsOut.open((Sample.StatsPrefix + "_RTIs.txt").c_str(), ios::binary);
+		RTIHeadersOut.open((Sample.StatsPrefix + "_RTIHeaders.txt").c_str(), ios::binary);
+
+		//stats headers
+		for (s = 0; s < ShardCount; ++s){
+			getline(*ShardStats[s], Line);
+		}
+
+		StatsOut << Line << "\n";
+
+		PrintSampleReadCounts(Sample);
+
+		//molecules & stats rows in amplicon order; each shard holds its amplicons in the same order
+		bool Truncated = false;
+
+		for (n = 0; n < Amplicons.size(); ++n){
+
+			const string& AmpliconID = Amplicons[n].AmpliconID;
+			const unsigned Strand = AmpliconStrand[AmpliconID];
+			const unsigned Shard = AmpliconShards[n];
+			auto Counts = Summaries[Shard].Amplicons.find(AmpliconID);
+
+			if (Counts != Summaries[Shard].Amplicons.end()){
+
+				Sample.AmpliconUsableReads[AmpliconID] = Counts->second[0];
+				Sample.AmpliconUniqueReads[AmpliconID] = Counts->second[1];
+
+				Truncated |= CopyLines(*ShardDedupped[Shard * 4 + Strand * 2], Dedupped[Strand][0], Counts->second[2] * 4);
+				Truncated |= CopyLines(*ShardDedupped[Shard * 4 + Strand * 2 + 1], Dedupped[Strand][1], Counts->second[2] * 4);
+				Truncated |= CopyLines(*ShardStats[Shard], StatsOut, Counts->second[2]);
+			}
+
+			PrintAmpliconReadCounts(Sample, AmpliconID);
+		}
+
+		PrintSampleMoleculeCounts(Sample);
+
+		for (n = 0; n < Amplicons.size(); ++n){
+
+			const unsigned Strand = AmpliconStrand[Amplicons[n].AmpliconID];
+			const unsigned Shard = AmpliconShards[n];
+			auto Counts = Summaries[Shard].Amplicons.find(Amplicons[n].AmpliconID);
+
+			if (Counts != Summaries[Shard].Amplicons.end()){
+				Truncated |= CopyLines(*ShardTrimmed[Shard * 4 + Strand * 2], Trimmed[Strand][0], Counts->second[3] * 4);
+				Truncated |= CopyLines(*ShardTrimmed[Shard * 4 + Strand * 2 + 1], Trimmed[Strand][1], Counts->second[3] * 4);
+			}
+
+		}
+
+		//read headers back in input order
+		vector<unsigned long long> Ordinals(ShardCount);
+		vector<string> Lines(ShardCount);
+		vector<bool> More(ShardCount);
+		unsigned Next;
+
+		for (s = 0; s < ShardCount; ++s){
+			More[s] = getShardedRTIHeader(*ShardRTIHeaders[s], Ordinals[s], Lines[s]);
+		}
+
+		while (true){
+
+			Next = ShardCount;
+
+			for (s = 0; s < ShardCount; ++s){
+				if (More[s] == true && (Next == ShardCount || Ordinals[s] < Ordinals[Next])){
+					Next = s;
+				}
+			}
+
+			if (Next == ShardCount){
+				break;
+			}
+
+			RTIHeadersOut << Lines[Next] << "\n";
+			More[Next] = getShardedRTIHeader(*ShardRTIHeaders[Next], Ordinals[Next], Lines[Next]);
+		}
+
+		//every record accounted for by the summaries
+		for (const auto & In : { &ShardDedupped, &ShardTrimmed, &ShardStats }){
+			for (const auto & File : *In){
+				Truncated |= File->peek() != char_traits<char>::eof();
+			}
+		}
+
+		if (Truncated == true){
+			cerr << "ERROR: Shard outputs for " << Sample.SampleID << " do not match their summaries; rerun the failed shard." << endl;
+			return -1;
+		}
+
+	}
+
+	return 0;
+}
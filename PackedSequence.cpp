@@ -0,0 +1,502 @@
+/*
+* Filename : PackedSequence.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Nucleotides packed 2 bits per base with a separate N mask; SSSE3 reverse complement and XOR/popcount comparison; binned qualities
+* Status: Release
+*/
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <RemoveAmpliconDuplicates.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PACKED_SSSE3 1
+#endif
+
+//hardware popcount where available; chosen once at load time
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define POPCNT_DISPATCH __attribute__((target_clones("popcnt", "default")))
+#else
+#define POPCNT_DISPATCH
+#endif
+
+using namespace std;
+
+static const char PackedBases[] = { 'A', 'C', 'G', 'T' };
+
+static const vector<unsigned char> BaseCodes = [](){ //4 = N; 5 = cannot be packed
+
+	vector<unsigned char> Codes(256, 5);
+
+	Codes['A'] = 0;
+	Codes['C'] = 1;
+	Codes['G'] = 2;
+	Codes['T'] = 3;
+	Codes['N'] = 4;
+
+	return Codes;
+}();
+
+static const vector<uint32_t> PackedByteChars = [](){ //a byte of four packed bases as the characters they unpack to
+
+	vector<uint32_t> ByteChars(256);
+	char Chars[4];
+
+	for (unsigned Byte = 0; Byte < 256; ++Byte){
+
+		for (unsigned n = 0; n < 4; ++n){
+			Chars[n] = PackedBases[(Byte >> (2 * n)) & 3];
+		}
+
+		memcpy(&ByteChars[Byte], Chars, 4);
+	}
+
+	return ByteChars;
+}();
+
+static uint64_t ReverseComplementWord(uint64_t Word){ //32 bases
+
+	Word = ~Word;
+	Word = ((Word >> 2) & 0x3333333333333333ULL) | ((Word & 0x3333333333333333ULL) << 2);
+	Word = ((Word >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((Word & 0x0F0F0F0F0F0F0F0FULL) << 4);
+
+	return __builtin_bswap64(Word);
+}
+
+static uint64_t ReverseWordBits(uint64_t Word){
+
+	Word = ((Word >> 1) & 0x5555555555555555ULL) | ((Word & 0x5555555555555555ULL) << 1);
+	Word = ((Word >> 2) & 0x3333333333333333ULL) | ((Word & 0x3333333333333333ULL) << 2);
+	Word = ((Word >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((Word & 0x0F0F0F0F0F0F0F0FULL) << 4);
+
+	return __builtin_bswap64(Word);
+}
+
+static const unsigned char QualityBins[] = { 0, 1, 6, 15, 22, 27, 33, 37, 40 };
+
+static unsigned char getQualityBinCode(const char QScore, const unsigned char Offset){
+
+	int Q = (unsigned char) QScore - Offset;
+
+	if (Q < 2) return Q < 0 ? 0 : Q;
+	if (Q < 10) return 2;
+	if (Q < 20) return 3;
+	if (Q < 25) return 4;
+	if (Q < 30) return 5;
+	if (Q < 35) return 6;
+	if (Q < 40) return 7;
+	return 8;
+}
+
+#ifdef PACKED_SSSE3
+__attribute__((target("ssse3")))
+static size_t ReverseComplementWordsSSSE3(const uint64_t* In, uint64_t* Out, const size_t Count){ //Out[k] = revcomp(In[Count - 1 - k]); returns words done
+
+	//reverse byte order, then each byte's four bases & complement by nibble lookup
+	const __m128i ReverseBytes = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i LowToHigh = _mm_set_epi8((char) 0x00, 0x40, (char) 0x80, (char) 0xC0, 0x10, 0x50, (char) 0x90, (char) 0xD0,
+		0x20, 0x60, (char) 0xA0, (char) 0xE0, 0x30, 0x70, (char) 0xB0, (char) 0xF0);
+	const __m128i HighToLow = _mm_set_epi8(0x0, 0x4, 0x8, 0xC, 0x1, 0x5, 0x9, 0xD, 0x2, 0x6, 0xA, 0xE, 0x3, 0x7, 0xB, 0xF);
+	const __m128i LowNibble = _mm_set1_epi8(0x0F);
+	size_t k;
+
+	for (k = 0; k + 2 <= Count; k += 2){
+
+		__m128i Words = _mm_loadu_si128((const __m128i*) (In + Count - 2 - k));
+
+		Words = _mm_shuffle_epi8(Words, ReverseBytes);
+		Words = _mm_or_si128(_mm_shuffle_epi8(LowToHigh, _mm_and_si128(Words, LowNibble)),
+			_mm_shuffle_epi8(HighToLow, _mm_and_si128(_mm_srli_epi16(Words, 4), LowNibble)));
+
+		_mm_storeu_si128((__m128i*) (Out + k), Words);
+	}
+
+	return k;
+}
+
+static const bool HasSSSE3 = __builtin_cpu_supports("ssse3");
+#endif
+
+void PackedSequence::Assign(string_view Seq){
+
+	unsigned char Code;
+	uint64_t Word, Ns;
+
+	Len = Seq.length();
+	Verbatim.clear();
+	Words.assign(BaseWords() + MaskWords(), 0);
+
+	uint64_t* Mask = Words.data() + BaseWords();
+
+	//one word of bases at a time; N leaves a zero code
+	for (size_t n = 0; n < Len; n += 32){
+
+		Word = 0;
+		Ns = 0;
+
+		for (size_t i = n; i < Len && i < n + 32; ++i){
+
+			Code = BaseCodes[(unsigned char) Seq[i]];
+
+			//lowercase & ambiguity codes are written back as read
+			if (Code > 4){
+				Words.clear();
+				Verbatim.assign(Seq);
+				return;
+			}
+
+			Word |= (uint64_t) (Code & 3) << (2 * (i - n));
+			Ns |= (uint64_t) (Code >> 2) << (i - n);
+		}
+
+		Words[n / 32] = Word;
+		Mask[n / 64] |= Ns << (n % 64);
+	}
+
+}
+
+bool PackedSequence::Matches(string_view Seq) const {
+
+	uint64_t Word, Ns;
+	uint32_t Chars;
+	size_t Count;
+
+	if (Seq.length() != Len){
+		return false;
+	} else if (isVerbatim() == true){
+		return Verbatim == Seq;
+	}
+
+	const uint64_t* Mask = Words.data() + BaseWords();
+
+	//unpack a word in place: four bases per lookup while it holds no N, base by base otherwise
+	for (size_t n = 0; n < Len; n += 32){
+
+		Word = Words[n / 32];
+		Ns = (Mask[n / 64] >> (n % 64)) & 0xFFFFFFFFULL;
+		Count = Len - n < 32 ? Len - n : 32;
+
+		if (Ns == 0 && Count == 32){
+
+			for (size_t b = 0; b < 8; ++b){
+
+				memcpy(&Chars, Seq.data() + n + b * 4, 4);
+
+				if (Chars != PackedByteChars[(Word >> (8 * b)) & 0xFF]){
+					return false;
+				}
+
+			}
+
+			continue;
+		}
+
+		for (size_t i = 0; i < Count; ++i){
+			if (Seq[n + i] != (((Ns >> i) & 1) == 1 ? 'N' : PackedBases[(Word >> (2 * i)) & 3])){
+				return false;
+			}
+		}
+
+	}
+
+	return true;
+}
+
+string PackedSequence::ToString() const {
+
+	if (isVerbatim() == true){
+		return Verbatim;
+	}
+
+	string Seq(Len, 'N');
+	const uint64_t* Mask = Words.data() + BaseWords();
+
+	for (size_t n = 0; n < Len; ++n){
+		if (((Mask[n / 64] >> (n % 64)) & 1) == 0){
+			Seq[n] = PackedBases[(Words[n / 32] >> (2 * (n % 32))) & 3];
+		}
+	}
+
+	return Seq;
+}
+
+uint64_t PackedSequence::getBases(size_t Pos) const {
+
+	if (Pos >= Len){
+		return 0;
+	}
+
+	if (isVerbatim() == true){
+
+		uint64_t Bases = 0;
+		unsigned char Code;
+
+		for (size_t n = Pos; n < Len && n < Pos + 32; ++n){
+			Code = BaseCodes[(unsigned char) Verbatim[n]];
+			Bases |= (uint64_t) (Code < 4 ? Code : 0) << (2 * (n - Pos));
+		}
+
+		return Bases;
+	}
+
+	size_t Word = Pos / 32, Shift = 2 * (Pos % 32);
+	uint64_t Bases = Words[Word] >> Shift;
+
+	if (Shift != 0 && Word + 1 < BaseWords()){
+		Bases |= Words[Word + 1] << (64 - Shift);
+	}
+
+	return Bases;
+}
+
+uint32_t PackedSequence::getNs(size_t Pos) const {
+
+	if (Pos >= Len){
+		return 0;
+	}
+
+	if (isVerbatim() == true){
+
+		uint32_t Ns = 0;
+
+		for (size_t n = Pos; n < Len && n < Pos + 32; ++n){
+			Ns |= (uint32_t) (BaseCodes[(unsigned char) Verbatim[n]] >= 4) << (n - Pos);
+		}
+
+		return Ns;
+	}
+
+	const uint64_t* Mask = Words.data() + BaseWords();
+	size_t Word = Pos / 64, Shift = Pos % 64;
+	uint64_t Ns = Mask[Word] >> Shift;
+
+	if (Shift != 0 && Word + 1 < MaskWords()){
+		Ns |= Mask[Word + 1] << (64 - Shift);
+	}
+
+	return (uint32_t) Ns;
+}
+
+PackedSequence PackedSequence::Substr(size_t Pos, size_t Count) const {
+
+	PackedSequence Sub;
+
+	Pos = min(Pos, Len);
+	Count = min(Count, Len - Pos);
+
+	if (isVerbatim() == true){
+		Sub.Assign(string_view(Verbatim).substr(Pos, Count));
+		return Sub;
+	}
+
+	Sub.Len = Count;
+	Sub.Words.assign(Sub.BaseWords() + Sub.MaskWords(), 0);
+
+	uint64_t* Mask = Sub.Words.data() + Sub.BaseWords();
+
+	for (size_t n = 0; n < Sub.BaseWords(); ++n){
+		Sub.Words[n] = getBases(Pos + n * 32);
+	}
+
+	for (size_t n = 0; n < Sub.MaskWords(); ++n){
+		Mask[n] = getNs(Pos + n * 64) | ((uint64_t) getNs(Pos + n * 64 + 32) << 32);
+	}
+
+	//clear bases past the end of the slice
+	if (Count % 32 != 0){
+		Sub.Words[Sub.BaseWords() - 1] &= (1ULL << (2 * (Count % 32))) - 1;
+	}
+
+	if (Count % 64 != 0){
+		Mask[Sub.MaskWords() - 1] &= (1ULL << (Count % 64)) - 1;
+	}
+
+	return Sub;
+}
+
+PackedSequence PackedSequence::ReverseComplement() const {
+	return ReverseComplementWords(true);
+}
+
+PackedSequence PackedSequence::ScalarReverseComplement() const {
+	return ReverseComplementWords(false);
+}
+
+PackedSequence PackedSequence::ReverseComplementWords(const bool SIMD) const {
+
+	PackedSequence RevComp;
+	size_t n = 0, Shift;
+
+	if (isVerbatim() == true){
+		RevComp.Assign(::ReverseComplement(Verbatim));
+		return RevComp;
+	}
+
+	RevComp.Len = Len;
+	RevComp.Words.assign(Words.size(), 0);
+
+	if (Len == 0){
+		return RevComp;
+	}
+
+	const size_t Bases = BaseWords(), Masks = MaskWords();
+	const uint64_t* Mask = Words.data() + Bases;
+	uint64_t* RevMask = RevComp.Words.data() + Bases;
+
+	//whole words reversed; padding in the last input word moves to the start
+#ifdef PACKED_SSSE3
+	if (SIMD == true && HasSSSE3 == true){
+		n = ReverseComplementWordsSSSE3(Words.data(), RevComp.Words.data(), Bases);
+	}
+#endif
+
+	for (; n < Bases; ++n){
+		RevComp.Words[n] = ReverseComplementWord(Words[Bases - 1 - n]);
+	}
+
+	for (n = 0; n < Masks; ++n){
+		RevMask[n] = ReverseWordBits(Mask[Masks - 1 - n]);
+	}
+
+	//shift out the padding
+	Shift = 2 * (Bases * 32 - Len);
+
+	for (n = 0; Shift != 0 && n < Bases; ++n){
+		RevComp.Words[n] = (RevComp.Words[n] >> Shift) | (n + 1 < Bases ? RevComp.Words[n + 1] << (64 - Shift) : 0);
+	}
+
+	Shift = Masks * 64 - Len;
+
+	for (n = 0; Shift != 0 && n < Masks; ++n){
+		RevMask[n] = (RevMask[n] >> Shift) | (n + 1 < Masks ? RevMask[n + 1] << (64 - Shift) : 0);
+	}
+
+	//N positions were complemented to T; restore the zero code
+	for (n = 0; n < Masks; ++n){
+		for (uint64_t Ns = RevMask[n]; Ns != 0; Ns &= Ns - 1){
+			Shift = n * 64 + __builtin_ctzll(Ns);
+			RevComp.Words[Shift / 32] &= ~(3ULL << (2 * (Shift % 32)));
+		}
+	}
+
+	return RevComp;
+}
+
+void PackedQualities::Assign(string_view Qual, const unsigned QScorePhredOffset, const bool Binned){
+
+	Len = Qual.length();
+
+	if (Binned == false){
+		Offset = 0;
+		Bytes.assign(Qual);
+		return;
+	}
+
+	Offset = QScorePhredOffset;
+	Bytes.assign((Len + 1) / 2, '\0');
+
+	for (size_t n = 0; n < Len; ++n){
+		Bytes[n / 2] |= getQualityBinCode(Qual[n], Offset) << (4 * (n % 2));
+	}
+
+}
+
+string PackedQualities::ToString() const {
+
+	if (Offset == 0){
+		return Bytes;
+	}
+
+	string Qual(Len, '\0');
+
+	for (size_t n = 0; n < Len; ++n){
+		Qual[n] = QualityBins[((unsigned char) Bytes[n / 2] >> (4 * (n % 2))) & 0xF] + Offset;
+	}
+
+	return Qual;
+}
+
+bool PackedQualities::Matches(string_view Qual) const {
+
+	if (Offset == 0){
+		return Bytes == Qual;
+	} else if (Qual.length() != Len){
+		return false;
+	}
+
+	for (size_t n = 0; n < Len; ++n){
+		if ((((unsigned char) Bytes[n / 2] >> (4 * (n % 2))) & 0xF) != getQualityBinCode(Qual[n], Offset)){
+			return false;
+		}
+	}
+
+	return true;
+}
+
+POPCNT_DISPATCH
+unsigned CountMismatches(const PackedSequence& A, const size_t APos, const PackedSequence& B, const size_t BPos, const size_t Count,
+	const unsigned Limit, size_t& Compared){
+
+	unsigned Total = 0, Chunk;
+	uint64_t Mismatches;
+
+	//as the string comparison; N & other characters only match themselves
+	if (A.isVerbatim() == true || B.isVerbatim() == true){
+
+		const string SeqA = A.ToString(), SeqB = B.ToString();
+
+		for (Compared = 0; Compared < Count; ++Compared){
+			if (SeqA[APos + Compared] != SeqB[BPos + Compared] && ++Total > Limit){
+				Compared++;
+				return Total;
+			}
+		}
+
+		return Total;
+	}
+
+	for (size_t n = 0; n < Count; n += 32){
+
+		Mismatches = getChunkMismatches(A.getBases(APos + n), A.getNs(APos + n), B.getBases(BPos + n), B.getNs(BPos + n));
+
+		if (Count - n < 32){
+			Mismatches &= (1ULL << (2 * (Count - n))) - 1;
+		}
+
+		Chunk = __builtin_popcountll(Mismatches);
+
+		//locate the mismatch that exceeds the limit
+		if (Total + Chunk > Limit){
+
+			for (; Total < Limit; ++Total){
+				Mismatches &= Mismatches - 1;
+			}
+
+			Compared = n + __builtin_ctzll(Mismatches) / 2 + 1;
+			return Limit + 1;
+		}
+
+		Total += Chunk;
+	}
+
+	Compared = Count;
+	return Total;
+}
+
+POPCNT_DISPATCH
+unsigned getHammingDistance(const PackedSequence& A, const PackedSequence& B){ //must be the same length
+
+	size_t Compared;
+
+	//random template identifiers fit one word; bits past the end are zero in both
+	if (A.length() <= 32 && B.length() <= 32 && A.isVerbatim() == false && B.isVerbatim() == false){
+		return __builtin_popcountll(getChunkMismatches(A.getBases(0), A.getNs(0), B.getBases(0), B.getNs(0)));
+	}
+
+	return CountMismatches(A, 0, B, 0, min(A.length(), B.length()), ~0U, Compared);
+}
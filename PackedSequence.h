@@ -0,0 +1,95 @@
+/*
+* Filename : PackedSequence.h
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Nucleotides packed 2 bits per base with a separate N mask, other reads verbatim; qualities as ASCII or Illumina 8 level bins packed 4 bits per score
+* Status: Release
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+class PackedSequence {
+
+	public:
+
+		PackedSequence() : Len(0) {}
+		explicit PackedSequence(string_view Seq) { Assign(Seq); }
+
+		void Assign(string_view Seq); //A=0 C=1 G=2 T=3 plus the N mask; reads with any other character (lowercase, IUPAC) are kept verbatim
+		string ToString() const;
+		size_t length() const { return Len; }
+		bool isVerbatim() const { return Verbatim.empty() == false; }
+
+		PackedSequence ReverseComplement() const;
+		PackedSequence ScalarReverseComplement() const; //reference for the SIMD path
+		PackedSequence Substr(size_t Pos, size_t Count) const;
+
+		//32 bases from Pos, base n at bits 2n; zero past the end; verbatim characters other than ACGT read as N
+		uint64_t getBases(size_t Pos) const;
+		uint32_t getNs(size_t Pos) const;
+
+		bool Matches(string_view Seq) const; //same as this after Assign; nothing is allocated
+		bool operator==(const PackedSequence& Other) const { return Len == Other.Len && Words == Other.Words && Verbatim == Other.Verbatim; }
+
+	private:
+
+		size_t BaseWords() const { return (Len + 31) / 32; }
+		size_t MaskWords() const { return (Len + 63) / 64; }
+		PackedSequence ReverseComplementWords(const bool SIMD) const;
+
+		vector<uint64_t> Words; //bases (32 per word) then N mask (64 per word); unused high bits are zero; empty when verbatim
+		string Verbatim; //written back unchanged
+		size_t Len;
+
+};
+
+class PackedQualities {
+
+	public:
+
+		PackedQualities() : Len(0), Offset(0) {}
+
+		//binned: 0 & 1 kept, 2-9 = 6, 10-19 = 15, 20-24 = 22, 25-29 = 27, 30-34 = 33, 35-39 = 37, 40+ = 40
+		void Assign(string_view Qual, const unsigned QScorePhredOffset, const bool Binned);
+		string ToString() const;
+		size_t length() const { return Len; }
+
+		bool Matches(string_view Qual) const; //same as this after Assign
+		bool operator==(const PackedQualities& Other) const { return Len == Other.Len && Offset == Other.Offset && Bytes == Other.Bytes; }
+
+	private:
+
+		string Bytes; //ASCII, or two bin codes per byte low nibble first
+		size_t Len;
+		unsigned char Offset; //phred offset of binned scores; 0 = held as ASCII
+
+};
+
+	//mismatching bases of two 32 base chunks, one bit per base at bits 2n; N only matches N
+	inline uint64_t getChunkMismatches(const uint64_t BasesA, const uint32_t NsA, const uint64_t BasesB, const uint32_t NsB){
+
+		uint64_t Diff = BasesA ^ BasesB, Ns = NsA ^ NsB;
+
+		Diff = (Diff | (Diff >> 1)) & 0x5555555555555555ULL;
+
+		//spread N flags to even bits
+		Ns = (Ns | (Ns << 16)) & 0x0000FFFF0000FFFFULL;
+		Ns = (Ns | (Ns << 8)) & 0x00FF00FF00FF00FFULL;
+		Ns = (Ns | (Ns << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		Ns = (Ns | (Ns << 2)) & 0x3333333333333333ULL;
+		Ns = (Ns | (Ns << 1)) & 0x5555555555555555ULL;
+
+		return Diff | Ns;
+	}
+
+	//mismatches across Count bases, by character when either is verbatim; stops after Limit + 1 mismatches and reports the bases compared up to that point
+	unsigned CountMismatches(const PackedSequence& A, const size_t APos, const PackedSequence& B, const size_t BPos, const size_t Count,
+		const unsigned Limit, size_t& Compared);
+	unsigned getHammingDistance(const PackedSequence& A, const PackedSequence& B);
@@ -0,0 +1,204 @@
+/*
+* Filename : ProgressReporter.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Background thread writing run progress in Prometheus text format to a file or Unix socket
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+//published by the parsing thread once per batch; read by the sampler
+static atomic<unsigned long> ProgressPass(0), ProgressPairsRead(0), ProgressUndetermined(0), ProgressNMasked(0),
+	ProgressRTIQuality(0), ProgressUnmatched(0), ProgressShortInsert(0), ProgressMolecules(0);
+
+static thread ProgressThread;
+static mutex ProgressMutex;
+static condition_variable ProgressWake;
+static bool ProgressStopping = false;
+
+unsigned long getResidentBytes(){
+
+	unsigned long Pages = 0, ResidentPages = 0;
+	ifstream StatmIn("/proc/self/statm");
+
+	StatmIn >> Pages >> ResidentPages;
+
+	return ResidentPages * sysconf(_SC_PAGESIZE);
+}
+
+string FormatProgress(const double PairsPerSecond){
+
+	ostringstream Metrics;
+
+	Metrics << "# HELP rad_pass Input pass; 0 = sketch prepass, 1 = deduplication\n";
+	Metrics << "# TYPE rad_pass gauge\n";
+	Metrics << "rad_pass " << ProgressPass.load(memory_order_relaxed) << "\n";
+	Metrics << "# HELP rad_paired_reads_total Read pairs processed in this pass\n";
+	Metrics << "# TYPE rad_paired_reads_total counter\n";
+	Metrics << "rad_paired_reads_total " << ProgressPairsRead.load(memory_order_relaxed) << "\n";
+	Metrics << "# HELP rad_paired_reads_per_second Read pairs processed per second since the previous sample\n";
+	Metrics << "# TYPE rad_paired_reads_per_second gauge\n";
+	Metrics << "rad_paired_reads_per_second " << PairsPerSecond << "\n";
+	Metrics << "# HELP rad_discarded_paired_reads_total Read pairs discarded by each filter\n";
+	Metrics << "# TYPE rad_discarded_paired_reads_total counter\n";
+	Metrics << "rad_discarded_paired_reads_total{reason=\"undetermined\"} " << ProgressUndetermined.load(memory_order_relaxed) << "\n";
+	Metrics << "rad_discarded_paired_reads_total{reason=\"n_masked\"} " << ProgressNMasked.load(memory_order_relaxed) << "\n";
+	Metrics << "rad_discarded_paired_reads_total{reason=\"rti_quality\"} " << ProgressRTIQuality.load(memory_order_relaxed) << "\n";
+	Metrics << "rad_discarded_paired_reads_total{reason=\"unmatched_primer\"} " << ProgressUnmatched.load(memory_order_relaxed) << "\n";
+	Metrics << "rad_discarded_paired_reads_total{reason=\"short_insert\"} " << ProgressShortInsert.load(memory_order_relaxed) << "\n";
+	Metrics << "# HELP rad_distinct_molecules Amplicon:RTI molecules seen so far\n";
+	Metrics << "# TYPE rad_distinct_molecules gauge\n";
+	Metrics << "rad_distinct_molecules " << ProgressMolecules.load(memory_order_relaxed) << "\n";
+	Metrics << "# HELP rad_resident_memory_bytes Resident set size\n";
+	Metrics << "# TYPE rad_resident_memory_bytes gauge\n";
+	Metrics << "rad_resident_memory_bytes " << getResidentBytes() << "\n";
+
+	return Metrics.str();
+}
+
+bool WriteProgress(const string& Target, const string& Metrics){ //return success or failure
+
+	if (Target.compare(0, 5, "unix:") == 0){
+
+		//one connection per sample; the listener may come and go
+		struct sockaddr_un Address;
+		string SocketPath = Target.substr(5);
+		int Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if (Socket == -1 || SocketPath.length() >= sizeof(Address.sun_path)){
+			if (Socket != -1) close(Socket);
+			return 1;
+		}
+
+		memset(&Address, 0, sizeof(Address));
+		Address.sun_family = AF_UNIX;
+		strcpy(Address.sun_path, SocketPath.c_str());
+
+		if (connect(Socket, (struct sockaddr*) &Address, sizeof(Address)) != 0 || send(Socket, Metrics.data(), Metrics.length(), MSG_NOSIGNAL) != (ssize_t) Metrics.length()){
+			close(Socket);
+			return 1;
+		}
+
+		close(Socket);
+
+	} else {
+
+		//replace the file whole so scrapers never see a partial sample
+		string TempfN = Target + ".tmp";
+		ofstream ProgressOut(TempfN.c_str());
+
+		ProgressOut << Metrics;
+		ProgressOut.close();
+
+		if (ProgressOut.fail() || rename(TempfN.c_str(), Target.c_str()) != 0){
+			return 1;
+		}
+
+	}
+
+	return 0;
+}
+
+void RunProgressSampler(const string Target, const unsigned Interval){
+
+	unsigned long PreviousPairs = 0, Pairs;
+	double PairsPerSecond;
+	bool Warned = false, Stopping = false;
+	chrono::steady_clock::time_point PreviousTime = chrono::steady_clock::now(), Now;
+
+	while (Stopping == false){
+
+		{
+			unique_lock<mutex> Lock(ProgressMutex);
+			ProgressWake.wait_for(Lock, chrono::seconds(Interval), []{ return ProgressStopping; });
+			Stopping = ProgressStopping;
+		}
+
+		Now = chrono::steady_clock::now();
+		Pairs = ProgressPairsRead.load(memory_order_relaxed);
+
+		//the count restarts after the sketch prepass
+		PairsPerSecond = Pairs >= PreviousPairs ? (Pairs - PreviousPairs) / chrono::duration<double>(Now - PreviousTime).count() : 0;
+
+		if (WriteProgress(Target, FormatProgress(PairsPerSecond)) == 1 && Warned == false){
+			cerr << "WARNING: Unable to write progress to " << Target << endl;
+			Warned = true;
+		}
+
+		PreviousPairs = Pairs;
+		PreviousTime = Now;
+	}
+
+}
+
+void StartProgressReporter(const string& Target, const unsigned Interval){
+
+	ProgressThread = thread(RunProgressSampler, Target, Interval);
+
+	//error returns from main still stop the sampler before ProgressThread is destroyed
+	atexit(StopProgressReporter);
+
+}
+
+void PublishProgress(const vector<sampledata>& Samples, const unsigned Pass, const unsigned long PairsRead, const unsigned long UndeterminedReads){ //once per batch
+
+	unsigned long NMasked = 0, RTIQuality = 0, Unmatched = 0, ShortInsert = 0, Molecules = 0;
+
+	for (const sampledata& Sample : Samples){
+
+		NMasked += Sample.NMaskedReads;
+		RTIQuality += Sample.RTIQualityDiscardedReads;
+		Unmatched += Sample.TotalPairedReads - (Sample.PrimerMatchedReads + Sample.RTIQualityDiscardedReads + Sample.NMaskedReads);
+		ShortInsert += Sample.LenDiscardedReads;
+
+		for (const auto & Amplicon : Sample.Reads){
+			Molecules += Amplicon.second.size();
+		}
+
+	}
+
+	ProgressPass.store(Pass, memory_order_relaxed);
+	ProgressPairsRead.store(PairsRead, memory_order_relaxed);
+	ProgressUndetermined.store(UndeterminedReads, memory_order_relaxed);
+	ProgressNMasked.store(NMasked, memory_order_relaxed);
+	ProgressRTIQuality.store(RTIQuality, memory_order_relaxed);
+	ProgressUnmatched.store(Unmatched, memory_order_relaxed);
+	ProgressShortInsert.store(ShortInsert, memory_order_relaxed);
+	ProgressMolecules.store(Molecules, memory_order_relaxed);
+
+}
+
+void StopProgressReporter(){ //writes a final sample
+
+	if (ProgressThread.joinable() == false){
+		return;
+	}
+
+	{
+		lock_guard<mutex> Lock(ProgressMutex);
+		ProgressStopping = true;
+	}
+
+	ProgressWake.notify_one();
+	ProgressThread.join();
+
+}
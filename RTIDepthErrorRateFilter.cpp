@@ -11,26 +11,22 @@
 
 using namespace std;
 
-void RTIDepthErrorRateFilter(unordered_map<string, unordered_map<string, molecule>> & Reads, const unsigned MinRTIDepthErrorRate){ //amplicon, RTI, molecule
+void RTIDepthErrorRateFilter(unordered_map<string, molecule> & RTIs, const unsigned MinRTIDepthErrorRate){ //RTI, molecule of one amplicon
 
 	double AvgRTIErrorRate;
 
-	//iterate over amplicons with usable reads
-	for (auto & Amplicon : Reads){
+	//iterate over RTIs associated with this amplicon
+	for (auto & RTI : RTIs){
 
-		//iterate over RTIs associated with this amplicon
-		for (auto & RTI : Amplicon.second){
-
-			//skip over RTIs that will not be printed
-			if (RTI.second.PrintRead == false ){
-				continue;
-			}
+		//skip over RTIs that will not be printed
+		if (RTI.second.PrintRead == false ){
+			continue;
+		}
 
-			AvgRTIErrorRate = (double) RTI.second.RTIErrors / RTI.second.Frequency;
+		AvgRTIErrorRate = (double) RTI.second.RTIErrors / RTI.second.Frequency;
 
-			if (RTI.second.Frequency / AvgRTIErrorRate < MinRTIDepthErrorRate){
-				RTI.second.PrintRead = false;
-			}
+		if (RTI.second.Frequency / AvgRTIErrorRate < MinRTIDepthErrorRate){
+			RTI.second.PrintRead = false;
 		}
 	}
 
@@ -0,0 +1,105 @@
+/*
+* Filename : RTIHeadersWriter.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Writes the read header & RTI of every usable read pair as text lines or columnar blocks, continuing a checkpointed file on resume
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <SampleOutput.h>
+
+using namespace std;
+
+RTIHeadersWriter::RTIHeadersWriter(const bool BinaryStats, const bool Sharded, const unsigned BlockSize) :
+	BinaryStats(BinaryStats), Sharded(Sharded), BlockSize(BlockSize) {}
+
+bool RTIHeadersWriter::Open(const string& RTIHeadersfN, const string& SampleID, const vector<amplicon>& Amplicons, const unordered_map<string, bool>& AmpliconStrand,
+	const bool Resume, const unsigned long Offset){
+
+	RTIHeadersOut.push_back(ofstream());
+	Blocks.push_back(columnarblock());
+
+	if (RTIHeadersfN == ""){
+		return 0;
+	}
+
+	if (Resume == true){
+
+		//drop headers written after the checkpoint and continue the file
+		if (truncate(RTIHeadersfN.c_str(), Offset) != 0 && Offset > 0){
+			cerr << "ERROR: Unable to restore " << RTIHeadersfN << endl;
+			return 1;
+		}
+
+		RTIHeadersOut.back().open(RTIHeadersfN.c_str(), ios::app | ios::binary);
+
+	} else {
+		RTIHeadersOut.back().open(RTIHeadersfN.c_str(), ios::binary);
+	}
+
+	if (BinaryStats == true && RTIHeadersOut.back().is_open() && (Resume == false || Offset == 0)){
+		WriteColumnarHeader(RTIHeadersOut.back(), 0, SampleID, Amplicons, AmpliconStrand);
+	}
+
+	return 0;
+}
+
+bool RTIHeadersWriter::Write(const readpairview& ReadPair, const unsigned AmpliconNo, const string& RTI){ //return success or failure
+
+	if (BinaryStats == false){
+
+		//shards lead with the read pair ordinal; merge restores input order and drops it
+		if (Sharded == true){
+			RTIHeadersOut[ReadPair.SampleNo] << ReadPair.Ordinal << "\t";
+		}
+
+		RTIHeadersOut[ReadPair.SampleNo] << ReadPair.HeaderR1 << "\t" << RTI << "\n";
+		getStageCounters().BytesWritten += ReadPair.HeaderR1.length() + RTI.length() + 2;
+
+		return 0;
+	}
+
+	//read pair ordinal replaces the header
+	columnarblock& Block = Blocks[ReadPair.SampleNo];
+	unsigned long long PackedRTI;
+
+	if (PackRTI(RTI, PackedRTI) == 1){
+		return 1;
+	}
+
+	Block.AmpliconNos.push_back(AmpliconNo);
+	Block.RTIs.push_back(PackedRTI);
+	Block.Values.push_back(ReadPair.Ordinal);
+
+	if (Block.AmpliconNos.size() == BlockSize){
+		return WriteColumnarBlock(RTIHeadersOut[ReadPair.SampleNo], 0, Block);
+	}
+
+	return 0;
+}
+
+bool RTIHeadersWriter::Flush(vector<unsigned long>& Offsets){ //return success or failure
+
+	Offsets.assign(RTIHeadersOut.size(), 0);
+
+	for (unsigned n = 0; n < RTIHeadersOut.size(); ++n){
+
+		if (!RTIHeadersOut[n].is_open()){
+			continue;
+		}
+
+		if (WriteColumnarBlock(RTIHeadersOut[n], 0, Blocks[n]) == 1){
+			return 1;
+		}
+
+		RTIHeadersOut[n].flush();
+		Offsets[n] = RTIHeadersOut[n].tellp();
+	}
+
+	return 0;
+}
@@ -11,7 +11,7 @@
 
 using namespace std;
 
-bool RTIQfilter(const string& Qual, const unsigned RTILen, const unsigned QScorePhredOffset, const unsigned MinRTIBaseQScore){ //Check all bases of RTI are above minQx
+bool RTIQfilter(string_view Qual, const unsigned RTILen, const unsigned QScorePhredOffset, const unsigned MinRTIBaseQScore){ //Check all bases of RTI are above minQx
 
 	for (unsigned n = 0; n < RTILen; ++n){
 
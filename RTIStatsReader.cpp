@@ -0,0 +1,126 @@
+/*
+* Filename : RTIStatsReader.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Prints columnar _RTIs.rcol and _RTIHeaders.rcol files in the tab-separated layout of the text outputs
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+
+	//check argument number is correct; print usage
+	if (argc < 2) {
+		cerr << "\nProgram: RTIStatsReader" << endl;
+		cerr << "Contact: Matthew Lyon, WRGL/UoS (mlyon@live.co.uk)\n" << endl;
+		cerr << "Usage: RTIStatsReader <_RTIs.rcol|_RTIHeaders.rcol> [R1.fastq ...]\n" << endl;
+		cerr << "R1.fastq: input FASTQ used to restore read headers from read pair ordinals; after --resume top-ups give every run's R1 in order\n" << endl;
+		return -1;
+	}
+
+	unsigned long long PairsRead = 0;
+	unsigned LineNo = 0;
+	int NextFQ = 2, BlockStatus;
+	string FQLine, HeaderR1;
+	columnarheader Header;
+	columnarblock Block;
+
+	ifstream ColumnarIn(argv[1], ios::binary);
+	ifstream R1FQIn;
+
+	if (!ColumnarIn.is_open()){
+		cerr << "ERROR: Unable to open " << argv[1] << endl;
+		return -1;
+	}
+
+	if (ReadColumnarHeader(ColumnarIn, Header) == 1){
+		return -1;
+	}
+
+	if (argc > 2){
+		R1FQIn.open(argv[NextFQ++]);
+
+		if (!R1FQIn.is_open()){
+			cerr << "ERROR: Unable to open FASTQ file." << endl;
+			return -1;
+		}
+	}
+
+	if (Header.Table == 1){
+		cout << "SampleID\tAmplicon\tStrand\tRTI\tFrequency (Reads)\tSequenceErrors\n";
+	}
+
+	while ((BlockStatus = ReadColumnarBlock(ColumnarIn, Header, Block)) == 1){
+
+		for (unsigned n = 0; n < Block.AmpliconNos.size(); ++n){
+
+			if (Block.AmpliconNos[n] >= Header.AmpliconIDs.size()){
+				cerr << "ERROR: Amplicon dictionary index out of range." << endl;
+				return -1;
+			}
+
+			if (Header.Table == 1){
+				cout << Header.SampleID << "\t" << Header.AmpliconIDs[Block.AmpliconNos[n]] << "\t" << Header.AmpliconStrands[Block.AmpliconNos[n]] << "\t" << UnpackRTI(Block.RTIs[n]) << "\t" << Block.Values[n] << "\t" << Block.ReadErrors[n] << "\n";
+				continue;
+			}
+
+			//advance FASTQ to this read pair; ordinals only increase and continue across top-up inputs
+			while (R1FQIn.is_open() && PairsRead < Block.Values[n]){
+
+				if (!getline(R1FQIn, FQLine)){
+
+					if (NextFQ == argc){
+						cerr << "ERROR: Read pair " << Block.Values[n] << " is beyond the end of the FASTQ input." << endl;
+						return -1;
+					}
+
+					R1FQIn.close();
+					R1FQIn.clear();
+					R1FQIn.open(argv[NextFQ++]);
+
+					if (!R1FQIn.is_open()){
+						cerr << "ERROR: Unable to open FASTQ file." << endl;
+						return -1;
+					}
+
+					continue;
+				}
+
+				if (FQLine == ""){
+					continue;
+				}
+
+				LineNo++;
+
+				if (LineNo == 1){
+					HeaderR1 = FQLine;
+				} else if (LineNo == 4){
+					LineNo = 0;
+					PairsRead++;
+				}
+
+			}
+
+			if (R1FQIn.is_open()){
+				cout << HeaderR1 << "\t" << UnpackRTI(Block.RTIs[n]) << "\n";
+			} else {
+				cout << Block.Values[n] << "\t" << UnpackRTI(Block.RTIs[n]) << "\t" << Header.AmpliconIDs[Block.AmpliconNos[n]] << "\n";
+			}
+
+		}
+
+	}
+
+	if (BlockStatus == -1){
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,53 @@
+/*
+* Filename : ReadBody.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Shared sequence & quality of a read pair; fingerprints let byte-identical pairs skip scoring
+* Status: Release
+*/
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <functional>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+static size_t CombineFingerprint(const size_t Fingerprint, const string& Str){ //boost::hash_combine
+
+	return Fingerprint ^ (hash<string_view>()(Str) + 0x9e3779b97f4a7c15ULL + (Fingerprint << 6) + (Fingerprint >> 2));
+}
+
+size_t getReadBodyFingerprint(const string& SeqR1, const string& SeqR2, const string& QualR1, const string& QualR2){
+
+	size_t Fingerprint = 0;
+
+	Fingerprint = CombineFingerprint(Fingerprint, SeqR1);
+	Fingerprint = CombineFingerprint(Fingerprint, SeqR2);
+	Fingerprint = CombineFingerprint(Fingerprint, QualR1);
+	Fingerprint = CombineFingerprint(Fingerprint, QualR2);
+
+	return Fingerprint;
+}
+
+shared_ptr<const readbody> MakeReadBody(const string& SeqR1, const string& SeqR2, const string& QualR1, const string& QualR2, const size_t Fingerprint,
+	const unsigned QScorePhredOffset, const bool QualityBins){
+
+	shared_ptr<readbody> Body = make_shared<readbody>();
+
+	Body->SeqR1.Assign(SeqR1);
+	Body->SeqR2.Assign(SeqR2);
+	Body->QualR1.Assign(QualR1, QScorePhredOffset, QualityBins);
+	Body->QualR2.Assign(QualR2, QScorePhredOffset, QualityBins);
+	Body->Fingerprint = Fingerprint;
+
+	return Body;
+}
+
+bool IsSameReadBody(const readbody& Body, const string& SeqR1, const string& SeqR2, const string& QualR1, const string& QualR2, const size_t Fingerprint){
+
+	//fingerprints rule out almost every mismatch; the full comparison guards against collisions
+	return Body.Fingerprint == Fingerprint && Body.QualR1.Matches(QualR1) && Body.QualR2.Matches(QualR2) &&
+		Body.SeqR1.Matches(SeqR1) && Body.SeqR2.Matches(SeqR2);
+}
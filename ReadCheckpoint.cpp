@@ -0,0 +1,210 @@
+/*
+* Filename : ReadCheckpoint.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Restores per-sample counters, unfiltered molecule tables and downsampling reads from a binary checkpoint
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <DedupEngine.h>
+
+using namespace std;
+
+void ReadBinaryString(ifstream& In, string& Str){
+
+	unsigned Len = 0;
+
+	In.read((char*) &Len, sizeof(Len));
+
+	if (In.good()){
+		Str.resize(Len);
+		In.read(&Str[0], Len);
+	}
+
+}
+
+unsigned long ReadBinaryCount(ifstream& In){
+
+	unsigned long long Value = 0;
+	In.read((char*) &Value, sizeof(Value));
+
+	return Value;
+}
+
+//body numbers index the bodies already read; 0 = the reads follow
+shared_ptr<const readbody> ReadCheckpointBody(ifstream& In, vector<shared_ptr<const readbody>>& Bodies, const unsigned QScorePhredOffset, const bool QualityBins){
+
+	unsigned long BodyNo = ReadBinaryCount(In);
+	string SeqR1, SeqR2, QualR1, QualR2;
+
+	if (BodyNo > Bodies.size()){
+		In.setstate(ios::failbit); //reported as truncated
+		return NULL;
+	} else if (BodyNo > 0){
+		return Bodies[BodyNo - 1];
+	}
+
+	ReadBinaryString(In, SeqR1);
+	ReadBinaryString(In, SeqR2);
+	ReadBinaryString(In, QualR1);
+	ReadBinaryString(In, QualR2);
+	Bodies.push_back(MakeReadBody(SeqR1, SeqR2, QualR1, QualR2, ReadBinaryCount(In), QScorePhredOffset, QualityBins)); //binned qualities keep the raw fingerprint
+
+	return Bodies.back();
+}
+
+bool DedupEngine::RestoreCheckpoint(const string& CheckpointfN, const string& R1fN, vector<unsigned long>& RTIHeadersOffsets){ //return success or failure
+
+	unsigned long SampleCount, AmpliconCount, RTICount, Count, i, j, k;
+	unsigned n, ByteOrder = 0;
+	char Magic[8];
+	string SampleID, AmpliconID, RTI, HeaderR1, HeaderR2;
+	molecule TempRead;
+	unfilteredread TempUnfilteredRead;
+	vector<shared_ptr<const readbody>> Bodies;
+
+	ifstream CheckpointIn(CheckpointfN.c_str(), ios::binary);
+
+	if (!CheckpointIn.is_open()){
+		cerr << "ERROR: Unable to open checkpoint " << CheckpointfN << endl;
+		return 1;
+	}
+
+	CheckpointIn.read(Magic, 8);
+
+	if (!CheckpointIn.good() || string(Magic, 8) != "RADCKPT1"){
+		cerr << "ERROR: " << CheckpointfN << " is not a RemoveAmpliconDuplicates checkpoint." << endl;
+		return 1;
+	}
+
+	//counts are stored in the byte order of the machine that wrote them
+	CheckpointIn.read((char*) &ByteOrder, sizeof(ByteOrder));
+
+	if (CheckpointIn.good() && ByteOrder != 0x01020304){
+		cerr << "ERROR: Checkpoint " << CheckpointfN << " was written on a machine with a different byte order." << endl;
+		return 1;
+	}
+
+	//header
+	ReadBinaryString(CheckpointIn, Checkpoint.R1fN);
+	Checkpoint.Complete = CheckpointIn.get();
+	Checkpoint.PairsProcessed = ReadBinaryCount(CheckpointIn);
+	Checkpoint.UndeterminedReads = ReadBinaryCount(CheckpointIn);
+	Checkpoint.EarlierPairs = ReadBinaryCount(CheckpointIn);
+	Checkpoint.QualityBins = CheckpointIn.get();
+	SampleCount = ReadBinaryCount(CheckpointIn);
+
+	if (CheckpointIn.good() && Checkpoint.QualityBins != Parameters.QualityBins){
+		cerr << "ERROR: Checkpoint " << CheckpointfN << " was taken " << (Checkpoint.QualityBins ? "with" : "without") << " --qual-bins; resume with the same setting." << endl;
+		return 1;
+	}
+
+	RTIHeadersOffsets.assign(Samples.size(), 0);
+	TempRead.PrintRead = true; //state is stored before filtering
+
+	for (i = 0; i < SampleCount && CheckpointIn.good(); ++i){
+
+		ReadBinaryString(CheckpointIn, SampleID);
+
+		//find this sample in the current run; a single sample run takes the checkpoint sample whatever its filename
+		for (n = 0; n < Samples.size(); ++n){
+			if (Samples[n].SampleID == SampleID || (SampleCount == 1 && Samples.size() == 1)){
+				break;
+			}
+		}
+
+		if (n == Samples.size()){
+			cerr << "ERROR: Checkpoint sample " << SampleID << " is not part of this run." << endl;
+			return 1;
+		}
+
+		sampledata& Sample = Samples[n];
+
+		RTIHeadersOffsets[n] = ReadBinaryCount(CheckpointIn);
+		Sample.TotalPairedReads = ReadBinaryCount(CheckpointIn);
+		Sample.LenDiscardedReads = ReadBinaryCount(CheckpointIn);
+		Sample.RTIQualityDiscardedReads = ReadBinaryCount(CheckpointIn);
+		Sample.PrimerMatchedReads = ReadBinaryCount(CheckpointIn);
+		Sample.NMaskedReads = ReadBinaryCount(CheckpointIn);
+		Sample.TotalUsableReads = ReadBinaryCount(CheckpointIn);
+
+		Count = ReadBinaryCount(CheckpointIn);
+		for (j = 0; j < Count && CheckpointIn.good(); ++j){
+			ReadBinaryString(CheckpointIn, AmpliconID);
+			Sample.AmpliconUsableReads[AmpliconID] = ReadBinaryCount(CheckpointIn);
+		}
+
+		//amplicon, RTI, molecule
+		AmpliconCount = ReadBinaryCount(CheckpointIn);
+		for (j = 0; j < AmpliconCount && CheckpointIn.good(); ++j){
+
+			ReadBinaryString(CheckpointIn, AmpliconID);
+			RTICount = ReadBinaryCount(CheckpointIn);
+
+			unordered_map<string, molecule>& AmpliconReads = Sample.Reads[AmpliconID];
+			AmpliconReads.reserve(RTICount);
+
+			for (k = 0; k < RTICount && CheckpointIn.good(); ++k){
+				ReadBinaryString(CheckpointIn, RTI);
+				TempRead.Frequency = ReadBinaryCount(CheckpointIn);
+				CheckpointIn.read((char*) &TempRead.RTIErrors, sizeof(double));
+				CheckpointIn.read((char*) &TempRead.ReadErrors, sizeof(double));
+				ReadBinaryString(CheckpointIn, HeaderR1);
+				ReadBinaryString(CheckpointIn, HeaderR2);
+				TempRead.Header = EncodeHeaders(Codec, HeaderR1, HeaderR2);
+				TempRead.Body = ReadCheckpointBody(CheckpointIn, Bodies, Parameters.QScorePhredOffset, Parameters.QualityBins);
+
+				AmpliconReads[RTI] = TempRead;
+			}
+
+		}
+
+		//amplicon, reads kept for downsampling
+		AmpliconCount = ReadBinaryCount(CheckpointIn);
+		for (j = 0; j < AmpliconCount && CheckpointIn.good(); ++j){
+
+			ReadBinaryString(CheckpointIn, AmpliconID);
+			Count = ReadBinaryCount(CheckpointIn);
+
+			vector<unfilteredread>& Pool = Sample.UnfilteredReads[AmpliconID];
+			Pool.reserve(Count);
+
+			for (k = 0; k < Count && CheckpointIn.good(); ++k){
+				ReadBinaryString(CheckpointIn, HeaderR1);
+				ReadBinaryString(CheckpointIn, HeaderR2);
+				TempUnfilteredRead.Header = EncodeHeaders(Codec, HeaderR1, HeaderR2);
+				TempUnfilteredRead.Body = ReadCheckpointBody(CheckpointIn, Bodies, Parameters.QScorePhredOffset, Parameters.QualityBins);
+				Pool.push_back(TempUnfilteredRead);
+			}
+
+		}
+
+	}
+
+	if (!CheckpointIn.good()){
+		cerr << "ERROR: Checkpoint " << CheckpointfN << " is truncated." << endl;
+		return 1;
+	}
+
+	UndeterminedReads = Checkpoint.UndeterminedReads;
+
+	if (Checkpoint.Complete == false && Checkpoint.R1fN != R1fN){
+		cerr << "ERROR: Checkpoint was taken part way through " << Checkpoint.R1fN << "; resume with the same input." << endl;
+		return 1;
+	} else if (Checkpoint.Complete == true && Checkpoint.R1fN == R1fN){
+		cerr << "ERROR: Checkpoint already includes " << R1fN << "; supply top-up FASTQs only." << endl;
+		return 1;
+	} else if (Checkpoint.Complete == false){
+		SkipPairs = Checkpoint.PairsProcessed; //already in the molecule tables
+	} else {
+		Checkpoint.EarlierPairs += Checkpoint.PairsProcessed; //top-up ordinals follow the checkpointed inputs
+	}
+
+	return 0;
+}
@@ -0,0 +1,159 @@
+/*
+* Filename : ReadColumnar.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Reads RTI statistics written by WriteColumnar
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+unsigned long long ReadVarint(const string& Buffer, size_t& Pos){ //LEB128
+
+	unsigned long long Value = 0;
+	unsigned Shift = 0;
+
+	while (Pos < Buffer.length()){
+
+		Value |= (unsigned long long) (Buffer[Pos] & 0x7F) << Shift;
+		Shift += 7;
+
+		if ((Buffer[Pos++] & 0x80) == 0){
+			break;
+		}
+
+	}
+
+	return Value;
+}
+
+string UnpackRTI(unsigned long long PackedRTI){
+
+	const char Bases[] = { 'A', 'C', 'G', 'T', 'N', 'N', 'N', 'N' };
+	string RTI;
+
+	//bases sit below the sentinel bit
+	while (PackedRTI > 1){
+		RTI += Bases[PackedRTI & 7];
+		PackedRTI >>= 3;
+	}
+
+	return string(RTI.rbegin(), RTI.rend());
+}
+
+bool ReadColumnarHeader(ifstream& ColumnarIn, columnarheader& Header){ //return success or failure
+
+	char Magic[8];
+	unsigned Len, AmpliconCount;
+	string AmpliconID;
+
+	ColumnarIn.read(Magic, 8);
+
+	if (!ColumnarIn.good() || string(Magic, 8) != "RADCOL01"){
+		cerr << "ERROR: Not a RemoveAmpliconDuplicates columnar file." << endl;
+		return 1;
+	}
+
+	ColumnarIn.read((char*) &Header.Table, sizeof(Header.Table));
+	ColumnarIn.read((char*) &Len, sizeof(Len));
+	Header.SampleID.resize(Len);
+	ColumnarIn.read(&Header.SampleID[0], Len);
+
+	//amplicon dictionary
+	ColumnarIn.read((char*) &AmpliconCount, sizeof(AmpliconCount));
+	Header.AmpliconIDs.clear();
+	Header.AmpliconStrands.clear();
+
+	for (unsigned n = 0; n < AmpliconCount && ColumnarIn.good(); ++n){
+		ColumnarIn.read((char*) &Len, sizeof(Len));
+		AmpliconID.resize(Len);
+		ColumnarIn.read(&AmpliconID[0], Len);
+		Header.AmpliconIDs.push_back(AmpliconID);
+		Header.AmpliconStrands.push_back(ColumnarIn.get() == 1);
+	}
+
+	if (!ColumnarIn.good()){
+		cerr << "ERROR: Columnar file header is truncated." << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+int ReadColumnarBlock(ifstream& ColumnarIn, const columnarheader& Header, columnarblock& Block){ //returns 1 for a block, 0 at end of file, -1 if corrupt or truncated
+
+	unsigned RecordCount, RawLen, CompressedLen;
+	unsigned long long PreviousOrdinal = 0;
+	size_t Pos = 0;
+
+	Block.AmpliconNos.clear();
+	Block.RTIs.clear();
+	Block.Values.clear();
+	Block.ReadErrors.clear();
+
+	ColumnarIn.read((char*) &RecordCount, sizeof(RecordCount));
+
+	if (ColumnarIn.gcount() == 0 && ColumnarIn.eof()){
+		return 0; //end of file
+	}
+
+	ColumnarIn.read((char*) &RawLen, sizeof(RawLen));
+	ColumnarIn.read((char*) &CompressedLen, sizeof(CompressedLen));
+
+	//three varints of at most 10 bytes and one double per record
+	if (!ColumnarIn.good() || RecordCount == 0 || RawLen > (unsigned long long) RecordCount * (30 + sizeof(double)) || CompressedLen > compressBound(RawLen)){
+		cerr << "ERROR: Columnar block is corrupt or truncated." << endl;
+		return -1;
+	}
+
+	vector<Bytef> Compressed(CompressedLen);
+	string Raw(RawLen, '\0');
+	uLongf DestLen = RawLen;
+
+	ColumnarIn.read((char*) Compressed.data(), CompressedLen);
+
+	if (!ColumnarIn.good() || uncompress((Bytef*) &Raw[0], &DestLen, Compressed.data(), CompressedLen) != Z_OK || DestLen != RawLen){
+		cerr << "ERROR: Columnar block is corrupt or truncated." << endl;
+		return -1;
+	}
+
+	//columns
+	for (unsigned n = 0; n < RecordCount; ++n){
+		Block.AmpliconNos.push_back(ReadVarint(Raw, Pos));
+	}
+
+	for (unsigned n = 0; n < RecordCount; ++n){
+		Block.RTIs.push_back(ReadVarint(Raw, Pos));
+	}
+
+	for (unsigned n = 0; n < RecordCount; ++n){
+
+		if (Header.Table == 0){ //stored as differences
+			PreviousOrdinal += ReadVarint(Raw, Pos);
+			Block.Values.push_back(PreviousOrdinal);
+		} else {
+			Block.Values.push_back(ReadVarint(Raw, Pos));
+		}
+
+	}
+
+	//columns must fill the block exactly
+	if (RawLen - Pos != (Header.Table == 1 ? RecordCount * sizeof(double) : 0)){
+		cerr << "ERROR: Columnar block is corrupt or truncated." << endl;
+		return -1;
+	}
+
+	if (Header.Table == 1){
+		Block.ReadErrors.resize(RecordCount);
+		Raw.copy((char*) Block.ReadErrors.data(), RecordCount * sizeof(double), Pos);
+	}
+
+	return 1;
+}
@@ -12,28 +12,52 @@
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
-#include <random>
-#include <RemoveAmpliconDuplicates.h>
+#include <chrono>
+#include <memory>
+#include <unistd.h>
+#include <SampleOutput.h>
 
 using namespace std;
 
-int RandomGenerator(int i) {
-
-	random_device rnd;
-	return rnd() % i;
-
-}
-
 int main(int argc, char* argv[]) {
 
 	const float ProgramVersion = 0.4;
+	const chrono::steady_clock::time_point StartTime = chrono::steady_clock::now();
+
+	//combine the outputs of --shard runs
+	if (argc > 1 && string(argv[1]) == "merge"){
+		return MergeShards(argc, argv);
+	}
 
 	//check argument number is correct; print usage
-	if (argc != 4) { //program ampliconlist r1 r2
+	if (argc < 4) { //program ampliconlist r1 r2 [options]
 		cerr << "\nProgram: RemoveAmpliconDuplicates v" << ProgramVersion << ' ' << __DATE__ << ' ' << __TIME__ << endl;
 		cerr << "Contact: Matthew Lyon, WRGL/UoS (mlyon@live.co.uk)\n" << endl;
-		cerr << "Usage: RemoveAmpliconDuplicates <AmpliconList> <R1.fastq> <R2.fastq>\n" << endl;
+		cerr << "Usage: RemoveAmpliconDuplicates <AmpliconList> <R1.fastq> <R2.fastq> [options]" << endl;
+		cerr << "       RemoveAmpliconDuplicates <AmpliconList> - - [options] < interleaved.fastq > dedupped.fastq" << endl;
+		cerr << "       RemoveAmpliconDuplicates merge <AmpliconList> <R1.fastq> <R2.fastq> --shards <N> [--samplesheet <file>]\n" << endl;
 		cerr << "AmpliconList: AmpliconID ForwardPrimer ReversePrimer Strand\n" << endl;
+		cerr << "Options:" << endl;
+		cerr << "  --samplesheet <file>        demultiplex undetermined FASTQs inline; SampleID Index1 [Index2]" << endl;
+		cerr << "  --index1 <I1.fastq>         read barcodes from index reads instead of read headers" << endl;
+		cerr << "  --index2 <I2.fastq>         second index reads" << endl;
+		cerr << "  --barcode-mismatches <n>    mismatches tolerated across Index1+Index2 (0-3, default 1); other pairs are counted as undetermined, not written" << endl;
+		cerr << "  --checkpoint <file>         save molecule tables & downsampling reads periodically and after parsing" << endl;
+		cerr << "  --checkpoint-interval <n>   paired reads between checkpoints (default 10000000; 0 = end only)" << endl;
+		cerr << "  --resume <file>             continue a killed run or top up from a completed checkpoint" << endl;
+		cerr << "  --sketch-prepass            count molecules approximately first; keeps read bodies only for molecules that may pass & as many downsampled reads as they could need" << endl;
+		cerr << "  --stats-format <fmt>        text (default) or binary columnar _RTIs.rcol & _RTIHeaders.rcol; read with RTIStatsReader; RTIs of up to 21 A, C, G, T or N bases" << endl;
+		cerr << "  --report-json <file>        stage timings, counters, peak RSS and per-amplicon timing" << endl;
+		cerr << "  --trace <file>              Chrome/Perfetto trace-event JSON of batch, filter and write spans" << endl;
+		cerr << "  --progress <file|unix:path> Prometheus text progress, rewritten every --progress-interval seconds (default 10)" << endl;
+		cerr << "  --sample-id <id>            streaming mode sample name (default stdin)" << endl;
+		cerr << "  --stats <file>              streaming mode RTI stats; not written if omitted" << endl;
+		cerr << "  --rti-headers <file>        streaming mode RTI headers; not written if omitted" << endl;
+		cerr << "  --trimmed <file>            streaming mode interleaved downsampled reads; not written if omitted" << endl;
+		cerr << "  --bam                       unaligned BAM with RX, ZA, ZS, ZF & ZE tags instead of Dedupped FASTQs (stdout when streaming)" << endl;
+		cerr << "  --bam-threads <n>           BGZF compression threads (default 1)" << endl;
+		cerr << "  --qual-bins                 Illumina 8 level quality binning of stored & written reads; read errors use the original scores" << endl;
+		cerr << "  --shard <i/N>               only the amplicons hashed to shard i of N; outputs are tagged .Shard<i>of<N> for merge\n" << endl;
 		return -1;
 	}
 
@@ -45,45 +69,58 @@ int main(int argc, char* argv[]) {
 	const unsigned QScorePhredOffset = 33, MaxQScore = 40; //ILMN 1.8/1.9
 	const unsigned MinInsertSize = 5;
 	const unsigned MinRTIDepthErrorRate = 1000; //(RTI depth / highest base error rate of RTI) filter
+	const unsigned SketchDepth = 4; const unsigned long SketchWidth = 1 << 22; //count-min sketch rows & cells per row
+	const unsigned ColumnarBlockSize = 65536; //records per compressed block of binary stats
+	const unsigned ReadBatchSize = 4096; //read pairs parsed, matched and aggregated together
 
-	//stats
-	unsigned long TotalPairedReads = 0, LenDiscardedReads = 0, RTIQualityDiscardedReads = 0,
-		PrimerMatchedReads = 0, NMaskedReads = 0, TotalUsableMolecules = 0, TotalUsableReads = 0;
-	unordered_map<string, unsigned long> AmpliconUsableReads; //total reads passing filter per amplicon
-	unordered_map<string, unsigned long> AmpliconUniqueReads; //total reads after removing dups per amplicon
+	dedupparameters Parameters = { RTILen, AntiComplementaryRegionLen, MinRTIBaseQScore, MinRTIEditDistance,
+		QScorePhredOffset, MaxQScore, MinInsertSize, MinRTIDepthErrorRate, false };
 
 	//variables
-	unsigned LineNo = 0, GetHeader = 0, HammingDistance, n;
-	double ReadErrors, RTIErrors;
-	molecule SavedBestRead, TempRead;
-	unfilteredread TempUnfilteredRead;
-	unordered_map<string, vector<unfilteredread>> UnfilteredReads;
-	string FQLineR1, FQLineR2, HeaderR1, HeaderR2, SeqR1, SeqR2, QualR1, QualR2, RTI, RTIQualities;
+	unsigned n;
 	vector<amplicon> Amplicons;
-	unordered_map<string, unordered_map<string, molecule>> Reads; //<ampliconID><RTI> = molecule
 	unordered_map<string, bool> AmpliconStrand;
+	options Options;
+	vector<samplesheetentry> SampleSheet;
+	vector<sampledata> Samples;
+	vector<unsigned long> RTIHeadersOffsets;
+	bool RTIHeadersFailed = false;
 
-	//define input filenames & SampleID
+	//define input filenames
 	string AmpliconfN = argv[1], R1fN = argv[2], R2fN = argv[3];
-	string SampleID = getSampleID(R1fN);
+	string CommandLine = argv[0];
+
+	for (n = 1; n < (unsigned) argc; ++n){
+		CommandLine += ' ' + string(argv[n]);
+	}
+
+	if (getOptions(argc, argv, Options) == 1){
+		return -1; //error with optional arguments
+	}
+
+	Parameters.QualityBins = Options.QualityBins;
+
+	stagecounters& Counters = getStageCounters();
+	Counters.Timed = Options.ReportfN != "";
 
-	//Open files for reading or writing
+	//Open files for reading; streaming mode reads R1 & R2 alternately from stdin
 	ifstream AmpliconsIn(AmpliconfN.c_str());
-	ifstream R1FQIn(R1fN.c_str());
-	ifstream R2FQIn(R2fN.c_str());
-	ofstream R1Dedupped0((R1fN + ".Dedupped_0.fastq").c_str(), ios::binary);
-	ofstream R2Dedupped0((R2fN + ".Dedupped_0.fastq").c_str(), ios::binary);
-	ofstream R1Trimmed0((R1fN + ".Trimmed_0.fastq").c_str(), ios::binary);
-	ofstream R2Trimmed0((R2fN + ".Trimmed_0.fastq").c_str(), ios::binary);
-	ofstream R1Dedupped1((R1fN + ".Dedupped_1.fastq").c_str(), ios::binary);
-	ofstream R2Dedupped1((R2fN + ".Dedupped_1.fastq").c_str(), ios::binary);
-	ofstream R1Trimmed1((R1fN + ".Trimmed_1.fastq").c_str(), ios::binary);
-	ofstream R2Trimmed1((R2fN + ".Trimmed_1.fastq").c_str(), ios::binary);
-	ofstream StatsOut((R1fN.substr(0, R1fN.find_first_of('_')) + "_RTIs.txt").c_str());
-	ofstream RTIHeadersOut((R1fN.substr(0, R1fN.find_first_of('_')) + "_RTIHeaders.txt").c_str());
-
-	//print stats headers
-	StatsOut << "SampleID\tAmplicon\tStrand\tRTI\tFrequency (Reads)\tSequenceErrors\n";
+	ifstream R1FQIn, R2FQIn, I1FQIn, I2FQIn;
+	istream& R1In = Options.Stream == true ? cin : R1FQIn;
+	istream& R2In = Options.Stream == true ? cin : R2FQIn;
+
+	if (Options.Stream == false){
+		R1FQIn.open(R1fN.c_str());
+		R2FQIn.open(R2fN.c_str());
+	}
+
+	//deduplicated FASTQ takes stdout; logging moves to stderr
+	ios::sync_with_stdio(false);
+	ostream StreamOut(cout.rdbuf());
+
+	if (Options.Stream == true){
+		cout.rdbuf(cerr.rdbuf());
+	}
 
 	//print input pararmeters to user for logging
 	PrintParameters(argc, argv, ProgramVersion, RTILen, AntiComplementaryRegionLen, MinRTIBaseQScore, 
@@ -94,243 +131,260 @@ int main(int argc, char* argv[]) {
 		return -1; //error with amplicon input
 	}
 
-	//parse FASTQs
-	if (R1FQIn.is_open() && R2FQIn.is_open()) {
-		while (R1FQIn.good() && R2FQIn.good()) {
-		
-			getline(R1FQIn, FQLineR1);
-			getline(R2FQIn, FQLineR2);
+	//define samples & output filename stems
+	sampledata TempSample = sampledata();
 
-			if (FQLineR1 == "" || FQLineR2 == "") { //Skip empty lines
-				continue;
-			}
+	if (Options.Stream == true){
 
-			LineNo++;
+		TempSample.SampleID = Options.SampleID;
+		Samples.push_back(TempSample);
 
-			if (LineNo == 1) {
+	} else if (Options.SampleSheetfN == ""){
 
-				HeaderR1 = FQLineR1;
-				HeaderR2 = FQLineR2;
+		TempSample.SampleID = getSampleID(R1fN);
+		TempSample.R1fN = R1fN;
+		TempSample.R2fN = R2fN;
+		TempSample.StatsPrefix = R1fN.substr(0, R1fN.find_first_of('_'));
+		Samples.push_back(TempSample);
 
-				if (GetHeader < 10){ //Check header hamming distance equals 1
+	} else {
 
-					if (HeaderR1.length() != HeaderR2.length()){
-						cerr << "ERROR: Read header hamming distance does not equal one. Check FASTQ input." << endl;
-						return -1;
-					} else if (getHammingDistance(HeaderR1, HeaderR2) != 1){
-						cerr << "ERROR: Read header hamming distance does not equal one. Check FASTQ input." << endl;
-						return -1;
-					}
+		ifstream SamplesIn(Options.SampleSheetfN.c_str());
 
-					GetHeader++;
-				}
+		if (getSamples(SamplesIn, SampleSheet) == 1){
+			return -1; //error with sample sheet
+		}
 
-				TotalPairedReads++;
+		//write demultiplexed outputs alongside the undetermined FASTQs
+		string OutputDir = R1fN.substr(0, R1fN.find_last_of('/') + 1);
 
-			} else if (LineNo == 2) {
-				SeqR1 = FQLineR1;
-				SeqR2 = FQLineR2;
-			} else if (LineNo == 4) {
-				QualR1 = FQLineR1;
-				QualR2 = FQLineR2;
-				
-				LineNo = 0;
+		for (n = 0; n < SampleSheet.size(); ++n){
+			TempSample.SampleID = SampleSheet[n].SampleID;
+			TempSample.R1fN = OutputDir + SampleSheet[n].SampleID + "_R1.fastq";
+			TempSample.R2fN = OutputDir + SampleSheet[n].SampleID + "_R2.fastq";
+			TempSample.StatsPrefix = OutputDir + SampleSheet[n].SampleID;
+			Samples.push_back(TempSample);
+		}
 
-				if (SeqR1 == "NNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNN" || SeqR2 == "NNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNN"){
-					NMaskedReads++;
-					continue;
-				}
+		if (Options.Index1fN != ""){
+			I1FQIn.open(Options.Index1fN.c_str());
 
-				//Check if RTI consists of Qx bases
-				if (RTIQfilter(QualR1, RTILen, QScorePhredOffset, MinRTIBaseQScore) == false || RTIQfilter(QualR2, RTILen, QScorePhredOffset, MinRTIBaseQScore) == false){
-					RTIQualityDiscardedReads++;
-					continue; //skip counters with any bases less than minQscore
-				}
+			if (!I1FQIn.is_open()){
+				cerr << "ERROR: Unable to open index FASTQ file(s)." << endl;
+				return -1;
+			}
+		}
 
-				//Define RTI
-				RTI = SeqR1.substr(0, RTILen) + ReverseComplement(SeqR2.substr(0, RTILen));
-				RTIQualities = QualR1.substr(0, RTILen) + QualR2.substr(0, RTILen);
-					
-				//Trim RTI
-				SeqR1 = SeqR1.substr(RTILen + AntiComplementaryRegionLen, string::npos);
-				SeqR2 = SeqR2.substr(RTILen + AntiComplementaryRegionLen, string::npos);
-				QualR1 = QualR1.substr(RTILen + AntiComplementaryRegionLen, string::npos);
-				QualR2 = QualR2.substr(RTILen + AntiComplementaryRegionLen, string::npos);
+		if (Options.Index2fN != ""){
+			I2FQIn.open(Options.Index2fN.c_str());
 
-				//Iterate over amplicons
-				for (n = 0; n < Amplicons.size(); ++n) {
+			if (!I2FQIn.is_open()){
+				cerr << "ERROR: Unable to open index FASTQ file(s)." << endl;
+				return -1;
+			}
+		}
 
-					if (MatchPrimer(SeqR1, Amplicons[n].FPrimer) == 1) { //local alignment
-						if (MatchPrimer(SeqR2, Amplicons[n].RPrimer) == 1) { //read matches to this amplicon
+	}
 
-							PrimerMatchedReads++;
+	//shard outputs are tagged and combined by the merge subcommand
+	vector<bool> InShard;
 
-							//Trim adapter and right RTI from read
-							RightPrimerClipper(SeqR1, QualR1, ReverseComplement(Amplicons[n].RPrimer));
-							RightPrimerClipper(SeqR2, QualR2, ReverseComplement(Amplicons[n].FPrimer));
+	if (Options.ShardCount > 0){
 
-							//Reduce primer dimer; insert size less than MinInsertLength ignored
-							if (SeqR1.length() > Amplicons[n].FPrimerLen + Amplicons[n].RPrimerLen + MinInsertSize &&
-								SeqR2.length() > Amplicons[n].FPrimerLen + Amplicons[n].RPrimerLen + MinInsertSize) {
+		string ShardTag = ".Shard" + to_string(Options.ShardNo) + "of" + to_string(Options.ShardCount);
 
-								AmpliconUsableReads[Amplicons[n].AmpliconID]++;
-								TotalUsableReads++;
+		for (n = 0; n < Amplicons.size(); ++n){
+			InShard.push_back(getAmpliconShard(Amplicons[n].AmpliconID, Options.ShardCount) == Options.ShardNo - 1);
+		}
 
-								//Add read pair to vector for downsampling
-								TempUnfilteredRead.HeaderR1 = HeaderR1;
-								TempUnfilteredRead.HeaderR2 = HeaderR2;
-								TempUnfilteredRead.QualR1 = QualR1;
-								TempUnfilteredRead.QualR2 = QualR2;
-								TempUnfilteredRead.SeqR1 = SeqR1;
-								TempUnfilteredRead.SeqR2 = SeqR2;
+		for (n = 0; n < Samples.size(); ++n){
+			Samples[n].R1fN += ShardTag;
+			Samples[n].R2fN += ShardTag;
+			Samples[n].StatsPrefix += ShardTag;
+		}
 
-								UnfilteredReads[Amplicons[n].AmpliconID].push_back(TempUnfilteredRead);
+	}
 
-								//print read headers associated with each RTI
-								RTIHeadersOut << HeaderR1 << "\t" << RTI << "\n";
+	if (Options.Stream == false && (!R1FQIn.is_open() || !R2FQIn.is_open())){
+		cerr << "ERROR: Unable to open FASTQ file(s)." << endl;
+		return -1;
+	}
 
-								//Calculate number of readErrors across both reads & RTI
-								ReadErrors = CalcReadErrorRate(QualR1, QScorePhredOffset) + CalcReadErrorRate(QualR2, QScorePhredOffset);
-								RTIErrors = getHighestErrorRate(RTIQualities, QScorePhredOffset);
+	FastqPairReader Input(R1fN, R1In, R2In, I1FQIn.is_open() ? &I1FQIn : NULL, I2FQIn.is_open() ? &I2FQIn : NULL);
 
-								//check if this RTI has been seen before
-								if (Reads[Amplicons[n].AmpliconID].count(RTI) == 1){ //amplicon:RTI = molecule
+	if (Options.SampleSheetfN != "" && Input.setSampleSheet(SampleSheet, Options.MaxBarcodeMismatches) == 1){
+		return -1; //error with sample sheet
+	}
 
-									SavedBestRead = Reads[Amplicons[n].AmpliconID][RTI]; //get current best read for this RTI
+	DedupEngine Engine(Amplicons, AmpliconStrand, Parameters, Samples);
+	Engine.EnableInstrumentation(Counters, Options.TracefN != "");
 
-									if (SavedBestRead.ReadErrors > ReadErrors){ //overwrite old read with new read containing less readErrors
+	if (Options.ShardCount > 0){
+		Engine.RestrictAmplicons(InShard);
+	}
 
-										//overwrite with new record
-										Reads[Amplicons[n].AmpliconID][RTI] = MakeTempRead(HeaderR1, HeaderR2, SeqR1, SeqR2, QualR1, QualR2, 
-											ReadErrors, SavedBestRead.RTIErrors + RTIErrors, SavedBestRead.Frequency + 1); //increase RTI frequency
+	//restore molecule tables from an earlier run
+	if (Options.ResumefN != "" && Engine.RestoreCheckpoint(Options.ResumefN, R1fN, RTIHeadersOffsets) == 1){
+		return -1;
+	}
 
-									} else {
-										Reads[Amplicons[n].AmpliconID][RTI].Frequency++; //retain current record but increase frequency
-										Reads[Amplicons[n].AmpliconID][RTI].RTIErrors += RTIErrors; //retain current record but increase RTIErrors
-									}
+	//print read headers associated with each RTI
+	RTIHeadersWriter RTIHeaders(Options.BinaryStats, Options.ShardCount > 0, ColumnarBlockSize);
+	string RTIHeadersSuffix = Options.BinaryStats == true ? "_RTIHeaders.rcol" : "_RTIHeaders.txt";
 
-								} else { //not seen before
+	for (n = 0; n < Samples.size(); ++n){
 
-									//bank new record
-									Reads[Amplicons[n].AmpliconID][RTI] = MakeTempRead(HeaderR1, HeaderR2, SeqR1, SeqR2, QualR1, QualR2, ReadErrors, RTIErrors, 1);
-								}
+		//streaming mode RTI headers are only collected when named
+		if (RTIHeaders.Open(Options.Stream == true ? Options.RTIHeadersfN : Samples[n].StatsPrefix + RTIHeadersSuffix, Samples[n].SampleID, Amplicons, AmpliconStrand,
+			Options.Stream == false && Options.ResumefN != "", Options.ResumefN != "" ? RTIHeadersOffsets[n] : 0) == 1){
+			return -1;
+		}
 
-							} else { //?length greater than the sum of both primers
-								LenDiscardedReads++;
-							}
+	}
 
-						}//?reverse primer mataches
-						
-						break; //if forward primer is found dont count this read again
+	if (Options.Stream == false || Options.RTIHeadersfN != ""){
+		//the first failure is reported; the run fails once the input is read
+		Engine.OnUsableRead([&](const readpairview& ReadPair, const unsigned AmpliconNo, const string& RTI){
+			RTIHeadersFailed = RTIHeadersFailed || RTIHeaders.Write(ReadPair, AmpliconNo, RTI) == 1;
+		});
+	}
 
-					} //?forward primer matches
+	if (Options.CheckpointfN != ""){
+		Engine.EnableCheckpoints(Options.CheckpointfN, Options.CheckpointInterval, [&](vector<unsigned long>& Offsets){ return RTIHeadersFailed || RTIHeaders.Flush(Offsets) == 1; });
+	}
 
-				} //end iterating over amplicons
+	if (Options.SketchPrepass == true){
+		Engine.EnableSketchPrepass(SketchDepth, SketchWidth);
+	}
 
-			} //line if statement
-		} //finished reading FASTQs
+	if (Options.ProgressTarget != ""){
 
-	} else {
-		cerr << "ERROR: Unable to open FASTQ file(s)." << endl;
+		StartProgressReporter(Options.ProgressTarget, Options.ProgressInterval);
+
+		Engine.OnBatch([&](const unsigned Pass){
+			PublishProgress(Engine.getSamples(), Pass, Engine.getPairsRead(), Engine.getUndeterminedReads());
+		});
+
+	}
+
+	//the engine parses the FASTQs in batches then matches, clips and collapses each batch
+	if (Engine.ProcessInput(Input, ReadBatchSize) == 1){
 		return -1;
 	}
 
-	//Remove RTIs with low depth / error rate score
-	RTIDepthErrorRateFilter(Reads, MinRTIDepthErrorRate);
+	StopProgressReporter();
+
+	if (RTIHeadersFailed == true || RTIHeaders.Flush(RTIHeadersOffsets) == 1){
+		return -1;
+	}
 
-	//Remove RTIs with an edit distance less than MinRTIEditDistance --highest frequency RTIs will be prioritised
-	FilterRTIsbyEditDistance(Reads, MinRTIEditDistance);
+	LapStage(Counters, OutputStage);
 
-	//print stats
-	cout << "\nTotalPairedReads: " << TotalPairedReads << endl;
-	cout << "N-MaskedPairedReads: " << NMaskedReads << " (" << ((float)NMaskedReads / TotalPairedReads) * 100 << "%)" << endl;
-	cout << "RTIQualityDiscardedPairedReads: " << RTIQualityDiscardedReads << " (" << ((float)RTIQualityDiscardedReads / TotalPairedReads) * 100 << "%)" << endl;
-	cout << "UnmatchedPrimerPairedReads: " << TotalPairedReads - (PrimerMatchedReads + RTIQualityDiscardedReads + NMaskedReads) << " (" << ((float)(TotalPairedReads - (PrimerMatchedReads + RTIQualityDiscardedReads + NMaskedReads)) / TotalPairedReads) * 100 << "%)" << endl;
-	cout << "ShortInsertDiscardedPairedReads: " << LenDiscardedReads << " (" << ((float)LenDiscardedReads / TotalPairedReads) * 100 << "%)" << endl;
-	cout << "Amplicon\tUsableReads\tUniqueReads\tDuplicationRate" << endl;
+	if (Options.SampleSheetfN != ""){
+		cout << "\nUndeterminedPairedReads: " << Engine.getUndeterminedReads() << endl;
+	}
 
-	//print passing records and per-amplicon stats
-	for (n = 0; n < Amplicons.size(); ++n){
+	for (n = 0; n < Samples.size(); ++n){
 
-		for (pair<string, molecule> Read : Reads[Amplicons[n].AmpliconID]){ //RTI = molecule
+		if (Options.SampleSheetfN != ""){
+			cout << "\nSampleID: " << Samples[n].SampleID << endl;
+		}
 
-			if (Read.second.PrintRead == true){
+		sampleoutputs Outputs = sampleoutputs();
+		ofstream Dedupped[2][2], Trimmed[2][2], StatsOut, BamOut, SummaryOut;
 
-				TotalUsableMolecules++;
-				AmpliconUniqueReads[Amplicons[n].AmpliconID]++;
+		if (Options.Stream == true){
 
-				if (AmpliconStrand[Amplicons[n].AmpliconID] == 0){
-					R1Dedupped0 << Read.second.HeaderR1 << "\012";
-					R1Dedupped0 << Read.second.SeqR1 << "\012+\012";
-					R1Dedupped0 << Read.second.QualR1 << "\012";
+			//both strands interleaved on stdout; auxiliary outputs only when named
+			if (Options.TrimmedfN != ""){
+				Trimmed[0][0].open(Options.TrimmedfN.c_str(), ios::binary);
+			}
 
-					R2Dedupped0 << Read.second.HeaderR2 << "\012";
-					R2Dedupped0 << Read.second.SeqR2 << "\012+\012";
-					R2Dedupped0 << Read.second.QualR2 << "\012";
-				} else {
-					R1Dedupped1 << Read.second.HeaderR1 << "\012";
-					R1Dedupped1 << Read.second.SeqR1 << "\012+\012";
-					R1Dedupped1 << Read.second.QualR1 << "\012";
+			if (Options.StatsfN != ""){
+				StatsOut.open(Options.StatsfN.c_str(), ios::binary);
+			}
 
-					R2Dedupped1 << Read.second.HeaderR2 << "\012";
-					R2Dedupped1 << Read.second.SeqR2 << "\012+\012";
-					R2Dedupped1 << Read.second.QualR2 << "\012";
+			for (unsigned Strand = 0; Strand < 2; ++Strand){
+				for (unsigned Read = 0; Read < 2; ++Read){
+					Outputs.Dedupped[Strand][Read] = Options.Bam == false ? &StreamOut : NULL;
+					Outputs.Trimmed[Strand][Read] = Options.TrimmedfN != "" ? &Trimmed[0][0] : NULL;
 				}
-
-				//AmpliconID, RTI, RTI_Frequency, RTI_ReadErrors
-				StatsOut << SampleID << "\t" << Amplicons[n].AmpliconID << "\t" << AmpliconStrand[Amplicons[n].AmpliconID] << "\t" << Read.first << "\t" << Read.second.Frequency << "\t" << Read.second.ReadErrors << "\n";
 			}
 
-		}
+			Outputs.Stats = Options.StatsfN != "" ? &StatsOut : NULL;
 
-		//print per amplicon stats
-		if (AmpliconUsableReads.count(Amplicons[n].AmpliconID) == 1){ //reads associated with this amplicon
-			cout << Amplicons[n].AmpliconID << "\t" << AmpliconUsableReads[Amplicons[n].AmpliconID] << "\t" << AmpliconUniqueReads[Amplicons[n].AmpliconID] << "\t" << (1 - ((float)AmpliconUniqueReads[Amplicons[n].AmpliconID] / AmpliconUsableReads[Amplicons[n].AmpliconID])) * 100 << "%" << endl;
 		} else {
-			cout << Amplicons[n].AmpliconID << "\t" << 0 << "\t" << 0 << "\t" << 0 << endl;
-		}
 
-	} //finish iterating over amplicons
+			//Open files for writing
+			for (unsigned Strand = 0; Strand < 2; ++Strand){
+
+				if (Options.Bam == false){
+					Dedupped[Strand][0].open((Samples[n].R1fN + ".Dedupped_" + to_string(Strand) + ".fastq").c_str(), ios::binary);
+					Dedupped[Strand][1].open((Samples[n].R2fN + ".Dedupped_" + to_string(Strand) + ".fastq").c_str(), ios::binary);
+				}
+
+				Trimmed[Strand][0].open((Samples[n].R1fN + ".Trimmed_" + to_string(Strand) + ".fastq").c_str(), ios::binary);
+				Trimmed[Strand][1].open((Samples[n].R2fN + ".Trimmed_" + to_string(Strand) + ".fastq").c_str(), ios::binary);
 
-	cout << "UniqueMolecules: " << TotalUsableMolecules << " (" << ((float)TotalUsableMolecules / TotalUsableReads) * 100 << "%)" << endl;
-	cout << "DuplicationRate: " << (1 - ((float)TotalUsableMolecules / TotalUsableReads)) * 100 << "%" << endl << endl;
+				for (unsigned Read = 0; Read < 2; ++Read){
+					Outputs.Dedupped[Strand][Read] = Options.Bam == false ? &Dedupped[Strand][Read] : NULL;
+					Outputs.Trimmed[Strand][Read] = &Trimmed[Strand][Read];
+				}
 
-	//print unfiltered downsampled reads
-	for (auto & Amplicon : UnfilteredReads){
-		
-		//randomly shuffle unfiltered paired reads
-		random_shuffle(Amplicon.second.begin(), Amplicon.second.end(), RandomGenerator);
+			}
 
-		if (AmpliconStrand[Amplicon.first] == 0){
-			
-			//select the first n reads giving the same depth per amplicon as filtered
-			for (n = 0; n < AmpliconUniqueReads[Amplicon.first]; ++n){
+			StatsOut.open((Samples[n].StatsPrefix + (Options.BinaryStats == true ? "_RTIs.rcol" : "_RTIs.txt")).c_str(), ios::binary);
+			Outputs.Stats = &StatsOut;
 
-				R1Trimmed0 << Amplicon.second[n].HeaderR1 << "\012";
-				R1Trimmed0 << Amplicon.second[n].SeqR1 << "\012+\012";
-				R1Trimmed0 << Amplicon.second[n].QualR1 << "\012";
-				
-				R2Trimmed0 << Amplicon.second[n].HeaderR2 << "\012";
-				R2Trimmed0 << Amplicon.second[n].SeqR2 << "\012+\012";
-				R2Trimmed0 << Amplicon.second[n].QualR2 << "\012";
+			if (Options.Bam == true){
+				BamOut.open((Samples[n].StatsPrefix + "_Dedupped.bam").c_str(), ios::binary);
+			}
 
+			if (Options.ShardCount > 0){
+				SummaryOut.open((Samples[n].StatsPrefix + "_Summary.txt").c_str(), ios::binary);
+				SummaryOut << "UndeterminedReads\t" << Engine.getUndeterminedReads() << "\n";
+				Outputs.Summary = &SummaryOut;
 			}
 
-		} else {
-			
-			//select the first n reads giving the same depth per amplicon as filtered
-			for (n = 0; n < AmpliconUniqueReads[Amplicon.first]; ++n){
+		}
 
-				R1Trimmed1 << Amplicon.second[n].HeaderR1 << "\012";
-				R1Trimmed1 << Amplicon.second[n].SeqR1 << "\012+\012";
-				R1Trimmed1 << Amplicon.second[n].QualR1 << "\012";
+		//both strands in one BAM; ZS carries the strand
+		unique_ptr<BgzfWriter> Bam;
 
-				R2Trimmed1 << Amplicon.second[n].HeaderR2 << "\012";
-				R2Trimmed1 << Amplicon.second[n].SeqR2 << "\012+\012";
-				R2Trimmed1 << Amplicon.second[n].QualR2 << "\012";
+		if (Options.Bam == true){
+			Bam.reset(new BgzfWriter(Options.Stream == true ? StreamOut : BamOut, Options.BamThreads));
+			WriteBamHeader(*Bam, Samples[n].SampleID, ProgramVersion, CommandLine);
+			Outputs.Bam = Bam.get();
+		}
 
-			}
+		//Remove RTIs with low depth / error rate score or too close to a more frequent RTI, then print passing records, downsampled reads and stats
+		unsigned long long TraceStartNs = Options.TracefN != "" ? TraceClock() : 0;
+		if (WriteSampleOutput(Engine, n, Options.BinaryStats, Outputs) == 1){
+			return -1;
+		}
+
+		if (Options.Bam == true){
+			Bam->Close();
+		}
+
+		LapStage(Counters, OutputStage);
+
+		if (Options.TracefN != ""){
+			AddTraceSpan("write", TraceStartNs, n);
+		}
+	}
+
+	StreamOut.flush();
+
+	if (Options.TracefN != "" && WriteTrace(Options.TracefN) == 1){
+		return -1;
+	}
+
+	if (Options.ReportfN != ""){
 
+		if (WriteRunReport(Options.ReportfN, SumStageCounters(), chrono::duration<double>(chrono::steady_clock::now() - StartTime).count(),
+			Engine.getPairsRead(), Engine.getUndeterminedReads(), Engine.getSamples(), Amplicons) == 1){
+			return -1;
 		}
 
 	}
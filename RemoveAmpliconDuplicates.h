@@ -5,20 +5,50 @@
 * Status: Release
 */
 
+#pragma once
+
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <fstream>
+#include <memory>
+#include <PackedSequence.h>
 
 using namespace std;
 
 //shared variable types
 	typedef struct {
-		string HeaderR1;
-		string HeaderR2;
-		string SeqR1;
-		string SeqR2;
-		string QualR1;
-		string QualR2;
+		unsigned Prefix; //instrument:run:flowcell: dictionary entry
+		unsigned Comment; //R1 & R2 comment dictionary entry
+		unsigned short Lane; //0 = headers held verbatim
+		unsigned Tile;
+		unsigned X;
+		unsigned Y;
+	} packedheader;
+
+	typedef struct {
+		vector<string> Prefixes;
+		unordered_map<string, unsigned> PrefixLookup;
+		vector<string> CommentsR1;
+		vector<string> CommentsR2;
+		unordered_map<string, unsigned> CommentLookup;
+		vector<string> Verbatim; //headers not in Illumina 1.8+ format; R1 & R2 in adjacent slots
+		vector<unsigned> VerbatimRefs; //per slot pair; molecules & downsampling reads holding the headers
+		vector<unsigned> FreeVerbatim; //released slot pairs, reused before Verbatim grows
+	} headercodec;
+
+	typedef struct {
+		PackedSequence SeqR1;
+		PackedSequence SeqR2;
+		PackedQualities QualR1; //binned with --qual-bins
+		PackedQualities QualR2;
+		size_t Fingerprint; //hash of the ASCII reads & unbinned qualities; identical read pairs share one body
+	} readbody;
+
+	typedef struct {
+		packedheader Header;
+		shared_ptr<const readbody> Body; //NULL for counts-only molecules
 		double ReadErrors;
 		double RTIErrors;
 		unsigned long Frequency;
@@ -26,12 +56,8 @@ using namespace std;
 	} molecule;
 
 	typedef struct {
-		string HeaderR1;
-		string HeaderR2;
-		string SeqR1;
-		string SeqR2;
-		string QualR1;
-		string QualR2;
+		packedheader Header;
+		shared_ptr<const readbody> Body;
 	} unfilteredread;
 
 	typedef struct {
@@ -48,19 +74,138 @@ using namespace std;
 		unsigned long Frequency;
 	} usableRTI;
 
+	typedef struct {
+		string SampleID;
+		string Barcode; //Index1[+Index2]
+	} samplesheetentry;
+
+	typedef struct {
+		string SampleID;
+		string R1fN; //output filename stems
+		string R2fN;
+		string StatsPrefix;
+		unsigned long TotalPairedReads, LenDiscardedReads, RTIQualityDiscardedReads,
+			PrimerMatchedReads, NMaskedReads, TotalUsableMolecules, TotalUsableReads;
+		unordered_map<string, unsigned long> AmpliconUsableReads; //total reads passing filter per amplicon
+		unordered_map<string, unsigned long> AmpliconUniqueReads; //total reads after removing dups per amplicon
+		unordered_map<string, unordered_map<string, molecule>> Reads; //<ampliconID><RTI> = molecule
+		unordered_map<string, vector<unfilteredread>> UnfilteredReads;
+	} sampledata;
+
+	typedef struct {
+		string SampleSheetfN; //inline demultiplexing of undetermined FASTQs
+		string Index1fN;
+		string Index2fN;
+		unsigned MaxBarcodeMismatches;
+		string CheckpointfN; //binary molecule table state
+		string ResumefN;
+		unsigned long CheckpointInterval; //paired reads between checkpoints
+		bool SketchPrepass; //skip read bodies for molecules certain to fail filtering
+		bool BinaryStats; //columnar _RTIs.rcol & _RTIHeaders.rcol instead of text
+		string ReportfN; //JSON run report
+		string TracefN; //Chrome trace-event JSON
+		string ProgressTarget; //Prometheus text file or unix:<socket path>
+		unsigned ProgressInterval; //seconds between progress samples
+		bool Stream; //interleaved FASTQ on stdin & deduplicated FASTQ on stdout
+		string SampleID; //stream mode names below replace those derived from R1
+		string StatsfN;
+		string RTIHeadersfN;
+		string TrimmedfN;
+		bool Bam; //unaligned BAM replaces the Dedupped FASTQs
+		unsigned BamThreads; //BGZF compression threads
+		bool QualityBins; //Illumina 8 level binning of stored & written qualities
+		unsigned ShardNo; //--shard i/N: amplicons hashed to shard i of N; 0 = not sharded
+		unsigned ShardCount;
+	} options;
+
+	typedef struct {
+		unsigned Table; //0 = RTI headers, 1 = RTIs
+		string SampleID;
+		vector<string> AmpliconIDs; //dictionary
+		vector<bool> AmpliconStrands;
+	} columnarheader;
+
+	typedef struct {
+		vector<unsigned> AmpliconNos;
+		vector<unsigned long long> RTIs; //packed
+		vector<unsigned long long> Values; //read pair ordinal or frequency
+		vector<double> ReadErrors; //RTIs table only
+	} columnarblock;
+
+	typedef struct {
+		unsigned Depth;
+		unsigned long Width; //cells per row; power of two
+		vector<unsigned char> Counts; //saturating frequency upper bound
+		vector<unsigned char> MaxRTIQScores; //upper bound of the best lowest RTI base quality
+	} countminsketch;
+
+	typedef struct {
+		string R1fN; //input the checkpoint was taken from
+		bool Complete; //false when taken part way through the input
+		unsigned long PairsProcessed;
+		unsigned long UndeterminedReads;
+		unsigned long EarlierPairs; //pairs of inputs completed before R1fN; read pair ordinals continue from here
+		bool QualityBins; //stored qualities are binned; resumes must match
+	} checkpointinfo;
+
+	enum reportstage { ParseStage, MatchStage, ClipStage, ErrorScoreStage, HashStage, DepthFilterStage, EditDistanceFilterStage, OutputStage, ReportStageCount };
+
+	typedef struct {
+		unsigned long long StageNs[ReportStageCount];
+		unsigned long long LapNs; //clock at the end of the previous stage
+		unsigned long long AlignmentCalls; //primer matching & clipping
+		unsigned long long HashProbes; //molecule table lookups & insertions while aggregating
+		unsigned long long DuplicateReads; //byte-identical to the stored read; not rescored
+		unsigned long long ExactClips; //clipped from a unique exact primer hit without an alignment
+		unsigned long long SketchMolecules; //distinct molecules of the sketch pre-pass
+		unsigned long long SketchCertainFails; //of which proven to fail RTIDepthErrorRateFilter; kept as counts only
+		unsigned long long BytesRead;
+		unsigned long long BytesWritten;
+		vector<unsigned long long> AmpliconReads; //by amplicon number
+		vector<unsigned long long> AmpliconReadNs;
+		unordered_map<string, unsigned long long> AmpliconFilterNs; //by AmpliconID
+		unordered_map<string, unsigned long long> AmpliconOutputNs;
+		bool Timed; //clock reads are skipped unless a report was requested
+	} stagecounters;
+
+	typedef struct {
+		const char* Name;
+		unsigned long long StartNs;
+		unsigned long long EndNs;
+		unsigned long long Arg; //batch or sample number
+	} tracespan;
+
+	typedef struct { //paired FASTQ record as read from disk
+		string HeaderR1;
+		string HeaderR2;
+		string SeqR1;
+		string SeqR2;
+		string QualR1;
+		string QualR2;
+		string Barcode; //index read sequences
+	} fastqpair;
+
 	//shared funtions
 	double CalcReadErrorRate(const string& Qual, const unsigned QScorePhredOffset);
 	bool getAmplicons(ifstream& AmpliconsIn, vector<amplicon>& Amplicons, unordered_map<string, bool>& AmpliconStrand);
 	unsigned getHammingDistance(const string& str1, const string& str2);
 	bool MatchPrimer(const string& Seq, const string& Primer);
 	string ReverseComplement(const string& DNA);
+	string ScalarReverseComplement(const string& DNA); //reference for the SIMD path
 	void RightPrimerClipper(string& Seq, string& Qual, const string& Primer);
-	void FilterRTIsbyEditDistance(unordered_map<string, unordered_map<string, molecule>> & Reads, const unsigned MinRTIEditDistance);
-	bool RTIQfilter(const string& Qual, const unsigned RTILen, const unsigned QScorePhredOffset, const unsigned MinRTIBaseQScore);
+	void FilterRTIsbyEditDistance(unordered_map<string, molecule> & RTIs, const unsigned MinRTIEditDistance);
+	bool RTIQfilter(string_view Qual, const unsigned RTILen, const unsigned QScorePhredOffset, const unsigned MinRTIBaseQScore);
 	string getSampleID(const string& FASTQFilename);
-	void RTIDepthErrorRateFilter(unordered_map<string, unordered_map<string, molecule>> & Reads, const unsigned MinRTIDepthErrorRate);
+	bool getFastqRecord(istream& FastqIn, string& Header, string& Seq, string& Qual, unsigned long long& BytesRead);
+	void RTIDepthErrorRateFilter(unordered_map<string, molecule> & RTIs, const unsigned MinRTIDepthErrorRate);
 	double getHighestErrorRate(const string& Qual, const unsigned QScorePhredOffset);
 
+	void PrintSampleReadCounts(const sampledata& Sample);
+	void PrintAmpliconReadCounts(const sampledata& Sample, const string& AmpliconID);
+	void PrintSampleMoleculeCounts(const sampledata& Sample);
+	unsigned getAmpliconShard(const string& AmpliconID, const unsigned ShardCount);
+	int MergeShards(int argc, char* argv[]);
+
 	void PrintParameters(int argc, char* argv[], const float ProgramVersion, const unsigned RTILen,
 		const unsigned AntiComplementaryRegionLen, const unsigned MinRTIBaseQScore, const unsigned MinRTIEditDistance,
 		const unsigned QScorePhredOffset, const unsigned MaxQScore, const unsigned MinInsertSize, const unsigned MinRTIDepthErrorRate);
@@ -68,5 +213,44 @@ using namespace std;
 	bool ReadMerger(const string& SeqR1, const string& QualR1, string SeqR2, string QualR2,
 		const unsigned MaxQScore, const unsigned QScorePhredOffset, pair<string, string>& MergedRead);
 
-	molecule MakeTempRead(const string& HeaderR1, const string& HeaderR2, const string& SeqR1, const string& SeqR2,
-		const string& QualR1, const string& QualR2, const double& ReadErrors, const double& RTIErrors, const unsigned long& Frequency);
+	bool getOptions(int argc, char* argv[], options& Options);
+	bool getSamples(ifstream& SamplesIn, vector<samplesheetentry>& SampleSheet);
+	bool BuildBarcodeLookup(const vector<samplesheetentry>& SampleSheet, const unsigned MaxBarcodeMismatches, unordered_map<string, int>& BarcodeLookup);
+	string getHeaderBarcode(const string& Header);
+	int getBarcodeSample(const unordered_map<string, int>& BarcodeLookup, const string& Barcode, const unsigned Index1Len, const unsigned Index2Len);
+	void InitSketch(countminsketch& Sketch, const unsigned Depth, const unsigned long Width);
+	void AddSketchKey(countminsketch& Sketch, const unsigned SampleNo, const unsigned AmpliconNo, const string& RTI, const unsigned RTIQScore);
+	bool SketchCertainFail(const countminsketch& Sketch, const unsigned SampleNo, const unsigned AmpliconNo, const string& RTI, const unsigned MinRTIDepthErrorRate);
+	size_t FindUniquePrimerEnd(const string& Seq, const string& Primer);
+	bool PackRTI(const string& RTI, unsigned long long& PackedRTI);
+	string UnpackRTI(unsigned long long PackedRTI);
+	void WriteColumnarHeader(ostream& ColumnarOut, const unsigned Table, const string& SampleID, const vector<amplicon>& Amplicons, const unordered_map<string, bool>& AmpliconStrand);
+	bool WriteColumnarBlock(ostream& ColumnarOut, const unsigned Table, columnarblock& Block);
+	bool ReadColumnarHeader(ifstream& ColumnarIn, columnarheader& Header);
+	int ReadColumnarBlock(ifstream& ColumnarIn, const columnarheader& Header, columnarblock& Block);
+
+	stagecounters& getStageCounters();
+	unsigned long long StageClock(const stagecounters& Counters);
+	void LapStage(stagecounters& Counters, const reportstage Stage);
+	stagecounters SumStageCounters();
+	bool WriteRunReport(const string& ReportfN, const stagecounters& Counters, const double WallSeconds, const unsigned long PairsRead,
+		const unsigned long UndeterminedReads, const vector<sampledata>& Samples, const vector<amplicon>& Amplicons);
+
+	unsigned long long TraceClock();
+	void AddTraceSpan(const char* Name, const unsigned long long StartNs, const unsigned long long Arg);
+	bool WriteTrace(const string& TracefN);
+
+	void StartProgressReporter(const string& Target, const unsigned Interval);
+	void PublishProgress(const vector<sampledata>& Samples, const unsigned Pass, const unsigned long PairsRead, const unsigned long UndeterminedReads);
+	void StopProgressReporter();
+
+	packedheader EncodeHeaders(headercodec& Codec, string_view HeaderR1, string_view HeaderR2); //verbatim headers are held once by the caller
+	void RetainHeader(headercodec& Codec, const packedheader& Header);
+	void ReleaseHeader(headercodec& Codec, const packedheader& Header); //verbatim slots are reused once nothing holds them
+	string DecodeHeader(const headercodec& Codec, const packedheader& Header, const unsigned ReadNo);
+
+	molecule MakeTempRead(const packedheader& Header, const shared_ptr<const readbody>& Body, const double& ReadErrors, const double& RTIErrors, const unsigned long& Frequency);
+	size_t getReadBodyFingerprint(const string& SeqR1, const string& SeqR2, const string& QualR1, const string& QualR2);
+	shared_ptr<const readbody> MakeReadBody(const string& SeqR1, const string& SeqR2, const string& QualR1, const string& QualR2, const size_t Fingerprint,
+		const unsigned QScorePhredOffset, const bool QualityBins);
+	bool IsSameReadBody(const readbody& Body, const string& SeqR1, const string& SeqR2, const string& QualR1, const string& QualR2, const size_t Fingerprint);
@@ -0,0 +1,54 @@
+/*
+* Filename : SampleOutput.h
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Writes what a DedupEngine selects: per-sample FASTQ, BAM & stats outputs and the RTI headers of usable reads
+* Status: Release
+*/
+
+#pragma once
+
+#include <string>
+#include <ostream>
+#include <fstream>
+#include <vector>
+#include <unordered_map>
+#include <DedupEngine.h>
+#include <BamWriter.h>
+
+using namespace std;
+
+	typedef struct {
+		ostream* Dedupped[2][2]; //strand, read; R1 & R2 sharing a stream are interleaved; NULL = not written
+		ostream* Trimmed[2][2];
+		ostream* Stats;
+		BgzfWriter* Bam; //unaligned BAM of passing molecules; NULL = not written
+		ostream* Summary; //counters & per amplicon record counts for merging shards; NULL = not written
+	} sampleoutputs;
+
+	//filters each amplicon then prints its passing records; downsampled reads and stats follow
+	bool WriteSampleOutput(DedupEngine& Engine, const unsigned SampleNo, const bool BinaryStats, const sampleoutputs& Outputs); //return success or failure
+
+class RTIHeadersWriter {
+
+	public:
+
+		//binary stats replace headers with read pair ordinals in columnar blocks; sharded text lines lead with the ordinal
+		RTIHeadersWriter(const bool BinaryStats, const bool Sharded, const unsigned BlockSize);
+
+		//one file per sample, in sample order; a resumed file is cut back to the bytes its checkpoint recorded; "" = not written
+		bool Open(const string& RTIHeadersfN, const string& SampleID, const vector<amplicon>& Amplicons, const unordered_map<string, bool>& AmpliconStrand,
+			const bool Resume, const unsigned long Offset); //return success or failure
+
+		bool Write(const readpairview& ReadPair, const unsigned AmpliconNo, const string& RTI); //return success or failure
+		bool Flush(vector<unsigned long>& Offsets); //writes held blocks; Offsets = bytes written per sample; return success or failure
+
+	private:
+
+		bool BinaryStats;
+		bool Sharded;
+		unsigned BlockSize;
+		vector<ofstream> RTIHeadersOut;
+		vector<columnarblock> Blocks;
+
+};
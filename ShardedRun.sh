@@ -0,0 +1,94 @@
+#!/bin/bash
+set -euo pipefail
+
+#Description: runs every --shard of one deduplication as local processes, then merges them into the outputs of an unsharded run; stands in for a cluster
+#Author: Matthew Lyon
+#Usage: ShardedRun.sh [--compare] <RemoveAmpliconDuplicates> <Shards> <AmpliconList> <R1.fastq> <R2.fastq> [options]
+#Each shard logs to Shard<i>of<N>.log in the working directory; shard outputs are left beside the merged files
+#--compare first keeps the outputs of an unsharded run in Unsharded/, then fails unless the merged outputs are byte-identical; Trimmed reads are random so only their counts are compared
+
+Compare=0
+if [ "${1:-}" = "--compare" ]; then
+    Compare=1
+    shift
+fi
+
+Binary="$1"
+Shards="$2"
+AmpliconList="$3"
+R1="$4"
+R2="$5"
+shift 5
+
+#merge needs the sample sheet the shards were given
+SampleSheet=()
+Args=("$@")
+for ((i = 0; i < ${#Args[@]}; i++)); do
+    if [ "${Args[$i]}" = "--samplesheet" ] && [ $((i + 1)) -lt ${#Args[@]} ]; then
+        SampleSheet=(--samplesheet "${Args[$((i + 1))]}")
+    fi
+done
+
+#the reference run takes the same paths, as sample IDs come from them; its outputs are moved aside before the shards write theirs
+if [ "$Compare" -eq 1 ]; then
+    rm -rf Unsharded
+    mkdir Unsharded
+    touch Unsharded/.Started
+    "$Binary" "$AmpliconList" "$R1" "$R2" "$@" > Unsharded.log
+    find "$(dirname "$R1")" -maxdepth 1 -type f -newer Unsharded/.Started ! -name Unsharded.log -exec mv {} Unsharded/ \;
+fi
+
+Pids=()
+for ((Shard = 1; Shard <= Shards; Shard++)); do
+    "$Binary" "$AmpliconList" "$R1" "$R2" "$@" --shard "$Shard/$Shards" > "Shard${Shard}of${Shards}.log" 2>&1 &
+    Pids+=($!)
+done
+
+Failed=0
+for ((Shard = 1; Shard <= Shards; Shard++)); do
+    if ! wait "${Pids[$((Shard - 1))]}"; then
+        echo "ERROR: shard $Shard/$Shards failed; see Shard${Shard}of${Shards}.log" >&2
+        Failed=1
+    fi
+done
+
+if [ "$Failed" -ne 0 ]; then
+    exit 1
+fi
+
+"$Binary" merge "$AmpliconList" "$R1" "$R2" --shards "$Shards" ${SampleSheet[@]+"${SampleSheet[@]}"} | tee Merged.log
+
+if [ "$Compare" -eq 0 ]; then
+    exit 0
+fi
+
+Differences=0
+for Reference in Unsharded/*; do
+    Merged="$(dirname "$R1")/$(basename "$Reference")"
+
+    case "$Reference" in
+        *.Trimmed_*)
+            if [ ! -f "$Merged" ] || [ "$(wc -l < "$Reference")" -ne "$(wc -l < "$Merged")" ]; then
+                echo "DIFF: $Merged has a different number of reads to $Reference" >&2
+                Differences=1
+            fi
+            ;;
+        *)
+            if ! cmp -s "$Reference" "$Merged"; then
+                echo "DIFF: $Merged differs from $Reference" >&2
+                Differences=1
+            fi
+            ;;
+    esac
+done
+
+if ! tail -n "$(wc -l < Merged.log)" Unsharded.log | cmp -s - Merged.log; then
+    echo "DIFF: merged summary differs from Unsharded.log" >&2
+    Differences=1
+fi
+
+if [ "$Differences" -ne 0 ]; then
+    exit 1
+fi
+
+echo "Merged outputs match the unsharded run" >&2
@@ -0,0 +1,216 @@
+/*
+* Filename : SimulateAmpliconReads.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Writes synthetic paired FASTQs with random template identifiers, anti-complementary spacers and primers laid out as RemoveAmpliconDuplicates expects
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <unordered_map>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+unsigned long long MixMoleculeHash(unsigned long long Hash){ //splitmix64
+
+	Hash += 0x9e3779b97f4a7c15ULL;
+	Hash = (Hash ^ (Hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	Hash = (Hash ^ (Hash >> 27)) * 0x94d049bb133111ebULL;
+
+	return Hash ^ (Hash >> 31);
+}
+
+string HashSeq(unsigned long long Hash, const unsigned Len){ //deterministic sequence for a molecule or amplicon
+
+	const char Bases[] = { 'A', 'C', 'G', 'T' };
+	string Seq;
+
+	for (unsigned n = 0; n < Len; ++n){
+
+		if (n % 32 == 0){
+			Hash = MixMoleculeHash(Hash);
+		}
+
+		Seq += Bases[(Hash >> ((n % 32) * 2)) & 3];
+	}
+
+	return Seq;
+}
+
+void WriteRandomAmplicons(const string& AmpliconfN, const unsigned AmpliconCount, const unsigned long long Seed){
+
+	ofstream AmpliconsOut(AmpliconfN.c_str());
+
+	AmpliconsOut << "#AmpliconID\tForwardPrimer\tReversePrimer\tStrand\n";
+
+	for (unsigned n = 0; n < AmpliconCount; ++n){
+		AmpliconsOut << "SIM" << n << "\t" << HashSeq(Seed ^ (2 * n), 18 + n % 13) << "\t" << HashSeq(Seed ^ (2 * n + 1), 18 + (n * 7) % 13) << "\t" << n % 2 << "\n";
+	}
+
+}
+
+int main(int argc, char* argv[]) {
+
+	//check argument number is correct; print usage
+	if (argc < 3) {
+		cerr << "\nProgram: SimulateAmpliconReads" << endl;
+		cerr << "Contact: Matthew Lyon, WRGL/UoS (mlyon@live.co.uk)\n" << endl;
+		cerr << "Usage: SimulateAmpliconReads <AmpliconList> <OutputPrefix> [options]\n" << endl;
+		cerr << "Writes <OutputPrefix>_S1_L001_R1_001.fastq & <OutputPrefix>_S1_L001_R2_001.fastq\n" << endl;
+		cerr << "Options:" << endl;
+		cerr << "  --pairs <n>               read pairs (default 100000)" << endl;
+		cerr << "  --duplication <rate>      expected fraction of duplicate pairs (default 0.9)" << endl;
+		cerr << "  --error-rate <p>          per-base substitution rate (default 0.002)" << endl;
+		cerr << "  --dimer-rate <p>          fraction of primer-dimer pairs (default 0.01)" << endl;
+		cerr << "  --read-length <bp>        (default 150)" << endl;
+		cerr << "  --insert-length <bp>      mean insert between primers (default 120)" << endl;
+		cerr << "  --random-amplicons <n>    write n random amplicons to <AmpliconList> first" << endl;
+		cerr << "  --rti-diversity <n>       molecules draw their RTI pair from n distinct pairs; 0 = one per molecule (default 0)" << endl;
+		cerr << "  --seed <n>\n" << endl;
+		return -1;
+	}
+
+	//RemoveAmpliconDuplicates layout
+	const unsigned RTILen = 5;
+	const string SpacerR1 = "GAC", SpacerR2 = "TCA"; //anti-complementary regions
+	const string Adapter = "AGATCGGAAGAGCACACGTCTGAACTCCAGTCACAGATCGGAAGAGCGTCGTGTAGGGAAAGAGTGT";
+	const unsigned QScorePhredOffset = 33;
+
+	string AmpliconfN = argv[1], OutputPrefix = argv[2], Option;
+	unsigned long Pairs = 100000, Molecules, MoleculeNo;
+	double DuplicationRate = 0.9, ErrorRate = 0.002, DimerRate = 0.01;
+	unsigned ReadLength = 150, InsertLength = 120, RandomAmplicons = 0, n;
+	unsigned long RTIDiversity = 0, RTIPairNo;
+	unsigned long long Seed = 1;
+	vector<amplicon> Amplicons;
+	unordered_map<string, bool> AmpliconStrand;
+	vector<string> Inserts;
+	string Molecule, RTIR1, RTIR2, SeqR1, SeqR2, QualR1, QualR2, Header;
+
+	for (int i = 3; i < argc; i += 2){
+
+		Option = argv[i];
+
+		//every option takes a value
+		if (i + 1 == argc){
+			cerr << "ERROR: Missing value for option " << Option << endl;
+			return -1;
+		}
+
+		if (Option == "--pairs"){
+			Pairs = strtoul(argv[i + 1], NULL, 10);
+		} else if (Option == "--duplication"){
+			DuplicationRate = atof(argv[i + 1]);
+		} else if (Option == "--error-rate"){
+			ErrorRate = atof(argv[i + 1]);
+		} else if (Option == "--dimer-rate"){
+			DimerRate = atof(argv[i + 1]);
+		} else if (Option == "--read-length"){
+			ReadLength = atoi(argv[i + 1]);
+		} else if (Option == "--insert-length"){
+			InsertLength = atoi(argv[i + 1]);
+		} else if (Option == "--random-amplicons"){
+			RandomAmplicons = atoi(argv[i + 1]);
+		} else if (Option == "--rti-diversity"){
+			RTIDiversity = strtoul(argv[i + 1], NULL, 10);
+		} else if (Option == "--seed"){
+			Seed = strtoull(argv[i + 1], NULL, 10);
+		} else {
+			cerr << "ERROR: Unknown option " << Option << endl;
+			return -1;
+		}
+
+	}
+
+	if (RandomAmplicons > 0){
+		WriteRandomAmplicons(AmpliconfN, RandomAmplicons, Seed);
+	}
+
+	ifstream AmpliconsIn(AmpliconfN.c_str());
+
+	if (getAmplicons(AmpliconsIn, Amplicons, AmpliconStrand) == 1 || Amplicons.size() == 0){
+		cerr << "ERROR: No amplicons to simulate." << endl;
+		return -1;
+	}
+
+	//fixed insert per amplicon; +/- 20% of the mean
+	for (n = 0; n < Amplicons.size(); ++n){
+		Inserts.push_back(HashSeq(Seed * 31 + n, InsertLength * 4 / 5 + MixMoleculeHash(Seed + n) % (InsertLength * 2 / 5 + 1)));
+	}
+
+	//distinct molecules giving the requested duplication rate
+	Molecules = (unsigned long) (Pairs * (1 - DuplicationRate));
+
+	if (Molecules == 0){
+		Molecules = 1;
+	}
+
+	mt19937_64 Rng(Seed);
+	uniform_real_distribution<double> Uniform(0, 1);
+	char Bases[] = { 'A', 'C', 'G', 'T' };
+
+	ofstream R1Out((OutputPrefix + "_S1_L001_R1_001.fastq").c_str(), ios::binary);
+	ofstream R2Out((OutputPrefix + "_S1_L001_R2_001.fastq").c_str(), ios::binary);
+
+	for (unsigned long Pair = 0; Pair < Pairs; ++Pair){
+
+		MoleculeNo = Rng() % Molecules;
+		n = MoleculeNo % Amplicons.size();
+
+		//a small pool makes distinct molecules of an amplicon share RTIs
+		RTIPairNo = RTIDiversity == 0 ? MoleculeNo : MixMoleculeHash(Seed ^ MoleculeNo) % RTIDiversity;
+
+		RTIR1 = HashSeq(Seed ^ (RTIPairNo * 2 + 0x5eed), RTILen);
+		RTIR2 = HashSeq(Seed ^ (RTIPairNo * 2 + 0x5eee), RTILen);
+
+		//top strand: RTI spacer F-primer insert RC(R-primer) RC(spacer) RC(RTI); dimers have no insert
+		Molecule = RTIR1 + SpacerR1 + Amplicons[n].FPrimer + (Uniform(Rng) < DimerRate ? "" : Inserts[n]) +
+			ReverseComplement(RTIR2 + SpacerR2 + Amplicons[n].RPrimer);
+
+		SeqR1 = (Molecule + Adapter).substr(0, ReadLength);
+		SeqR2 = (ReverseComplement(Molecule) + Adapter).substr(0, ReadLength);
+
+		while (SeqR1.length() < ReadLength){
+			SeqR1 += 'A';
+		}
+
+		while (SeqR2.length() < ReadLength){
+			SeqR2 += 'A';
+		}
+
+		QualR1.assign(ReadLength, 'I');
+		QualR2.assign(ReadLength, 'I');
+
+		//substitutions carry a low quality score; tails degrade
+		for (unsigned i = 0; i < ReadLength; ++i){
+
+			QualR1[i] = QScorePhredOffset + 40 - (i * 12) / ReadLength - Rng() % 4;
+			QualR2[i] = QScorePhredOffset + 38 - (i * 16) / ReadLength - Rng() % 6;
+
+			if (Uniform(Rng) < ErrorRate){
+				SeqR1[i] = Bases[(string("ACGT").find(SeqR1[i]) + 1 + Rng() % 3) % 4];
+				QualR1[i] = QScorePhredOffset + 5 + Rng() % 10;
+			}
+
+			if (Uniform(Rng) < ErrorRate){
+				SeqR2[i] = Bases[(string("ACGT").find(SeqR2[i]) + 1 + Rng() % 3) % 4];
+				QualR2[i] = QScorePhredOffset + 5 + Rng() % 10;
+			}
+
+		}
+
+		//headers differ only by read number
+		Header = "@SIM:1:FCSIM:1:" + to_string(1101 + (Pair / 4000000) % 20) + ":" + to_string(Pair % 2000) + ":" + to_string((Pair / 2000) % 200000);
+
+		R1Out << Header << " 1:N:0:1\n" << SeqR1 << "\n+\n" << QualR1 << "\n";
+		R2Out << Header << " 2:N:0:1\n" << SeqR2 << "\n+\n" << QualR2 << "\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+* Filename : StageCounters.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Thread-local per-stage timers and counters summed for the run report
+* Status: Release
+*/
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+static mutex StageCountersMutex;
+static vector<stagecounters*> LiveStageCounters;
+static stagecounters RetiredStageCounters = stagecounters(); //threads that have exited
+
+void MergeStageCounters(stagecounters& Total, const stagecounters& Counters){
+
+	for (unsigned n = 0; n < ReportStageCount; ++n){
+		Total.StageNs[n] += Counters.StageNs[n];
+	}
+
+	Total.AlignmentCalls += Counters.AlignmentCalls;
+	Total.HashProbes += Counters.HashProbes;
+	Total.DuplicateReads += Counters.DuplicateReads;
+	Total.ExactClips += Counters.ExactClips;
+	Total.SketchMolecules += Counters.SketchMolecules;
+	Total.SketchCertainFails += Counters.SketchCertainFails;
+	Total.BytesRead += Counters.BytesRead;
+	Total.BytesWritten += Counters.BytesWritten;
+
+	if (Total.AmpliconReads.size() < Counters.AmpliconReads.size()){
+		Total.AmpliconReads.resize(Counters.AmpliconReads.size());
+		Total.AmpliconReadNs.resize(Counters.AmpliconReads.size());
+	}
+
+	for (unsigned n = 0; n < Counters.AmpliconReads.size(); ++n){
+		Total.AmpliconReads[n] += Counters.AmpliconReads[n];
+		Total.AmpliconReadNs[n] += Counters.AmpliconReadNs[n];
+	}
+
+	for (const auto & Amplicon : Counters.AmpliconFilterNs){
+		Total.AmpliconFilterNs[Amplicon.first] += Amplicon.second;
+	}
+
+	for (const auto & Amplicon : Counters.AmpliconOutputNs){
+		Total.AmpliconOutputNs[Amplicon.first] += Amplicon.second;
+	}
+
+}
+
+//registered on first use by a thread; folded into the retired totals when the thread exits
+struct threadstagecounters {
+
+	stagecounters Counters = stagecounters();
+
+	threadstagecounters(){
+		lock_guard<mutex> Lock(StageCountersMutex);
+		LiveStageCounters.push_back(&Counters);
+	}
+
+	~threadstagecounters(){
+		lock_guard<mutex> Lock(StageCountersMutex);
+		MergeStageCounters(RetiredStageCounters, Counters);
+		LiveStageCounters.erase(find(LiveStageCounters.begin(), LiveStageCounters.end(), &Counters));
+	}
+
+};
+
+stagecounters& getStageCounters(){
+
+	thread_local threadstagecounters Thread;
+	return Thread.Counters;
+
+}
+
+unsigned long long StageClock(const stagecounters& Counters){
+
+	if (Counters.Timed == false){
+		return 0;
+	}
+
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LapStage(stagecounters& Counters, const reportstage Stage){ //time since the previous lap is charged to Stage
+
+	if (Counters.Timed == false){
+		return;
+	}
+
+	unsigned long long Now = StageClock(Counters);
+
+	Counters.StageNs[Stage] += Now - Counters.LapNs;
+	Counters.LapNs = Now;
+
+}
+
+stagecounters SumStageCounters(){ //call once worker threads are idle
+
+	lock_guard<mutex> Lock(StageCountersMutex);
+	stagecounters Total = RetiredStageCounters;
+
+	for (const stagecounters* Counters : LiveStageCounters){
+		MergeStageCounters(Total, *Counters);
+	}
+
+	return Total;
+}
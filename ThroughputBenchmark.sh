@@ -0,0 +1,66 @@
+#!/bin/bash
+set -euo pipefail
+
+#Description: end-to-end throughput of RemoveAmpliconDuplicates over synthetic data; prints a TSV of reads/s, wall time & max RSS
+#Author: Matthew Lyon
+#Usage: ThroughputBenchmark.sh <BuildDir> [WorkDir]
+#Grid overrides: AMPLICONS="1 10" PAIRS="100000" DUPLICATION="0.9" RTI_DIVERSITY="0 64" ERROR_RATE=0.002 DIMER_RATE=0.01 SEED=1
+#RTI_DIVERSITY: distinct RTI pairs the molecules share; 0 = one per molecule
+
+BuildDir="$1"
+WorkDir="${2:-ThroughputBenchmark}"
+
+AMPLICONS="${AMPLICONS:-1 10 100 1000 10000}"
+PAIRS="${PAIRS:-100000 1000000 10000000 100000000}"
+DUPLICATION="${DUPLICATION:-0.5 0.9}"
+RTI_DIVERSITY="${RTI_DIVERSITY:-0}"
+ERROR_RATE="${ERROR_RATE:-0.002}"
+DIMER_RATE="${DIMER_RATE:-0.01}"
+SEED="${SEED:-1}"
+
+#GNU time reports max RSS for the child
+TimeBin="${TIME_BIN:-/usr/bin/time}"
+if [ ! -x "$TimeBin" ]; then
+    echo "ERROR: GNU time not found at $TimeBin; set TIME_BIN" >&2
+    exit 1
+fi
+
+mkdir -p "$WorkDir"
+cd "$WorkDir"
+
+printf "Amplicons\tPairs\tDuplication\tRTIDiversity\tErrorRate\tDimerRate\tWallSeconds\tReadsPerSec\tMaxRSSKB\n"
+
+for Amplicons in $AMPLICONS; do
+    for Pairs in $PAIRS; do
+        for Duplication in $DUPLICATION; do
+            for RTIDiversity in $RTI_DIVERSITY; do
+
+                Prefix="Sim-$Amplicons-$Pairs-$Duplication-$RTIDiversity"
+
+                "$BuildDir"/SimulateAmpliconReads "$Prefix".amplicons.txt "$Prefix" \
+                --random-amplicons "$Amplicons" \
+                --pairs "$Pairs" \
+                --duplication "$Duplication" \
+                --rti-diversity "$RTIDiversity" \
+                --error-rate "$ERROR_RATE" \
+                --dimer-rate "$DIMER_RATE" \
+                --seed "$SEED"
+
+                "$TimeBin" -f "%e\t%M" -o "$Prefix".time \
+                "$BuildDir"/RemoveAmpliconDuplicates \
+                "$Prefix".amplicons.txt \
+                "$Prefix"_S1_L001_R1_001.fastq \
+                "$Prefix"_S1_L001_R2_001.fastq > "$Prefix".log
+
+                read -r Wall MaxRSS < <(tail -n1 "$Prefix".time)
+
+                printf "%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" "$Amplicons" "$Pairs" "$Duplication" "$RTIDiversity" "$ERROR_RATE" "$DIMER_RATE" \
+                "$Wall" "$(awk -v p="$Pairs" -v w="$Wall" 'BEGIN { if (w > 0) printf "%.0f", p / w; else print "NA" }')" "$MaxRSS"
+
+                #inputs, Dedupped & Trimmed FASTQs and RTI stats are the bulk of the disk use at large sizes; the log is kept
+                rm -f "$Prefix"_S1_L001_R?_001*.fastq "$Prefix"_RTIs.txt "$Prefix"_RTIHeaders.txt "$Prefix".amplicons.txt "$Prefix".time
+
+            done
+        done
+    done
+done
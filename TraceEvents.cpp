@@ -0,0 +1,118 @@
+/*
+* Filename : TraceEvents.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Records begin/end spans per thread and writes them as Chrome/Perfetto trace-event JSON
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+const unsigned long TraceBufferLen = 1 << 18; //spans kept per thread; later spans are counted and dropped
+
+typedef struct {
+	vector<tracespan> Spans; //fixed size; written only by the owning thread
+	unsigned long SpanCount;
+	unsigned long DroppedSpans;
+} tracebuffer;
+
+static mutex TraceBuffersMutex; //taken once per thread, on its first span
+static vector<unique_ptr<tracebuffer>> TraceBuffers; //kept after threads exit
+static const chrono::steady_clock::time_point TraceStart = chrono::steady_clock::now();
+
+unsigned long long TraceClock(){ //read only by callers recording spans
+
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - TraceStart).count();
+}
+
+tracebuffer& getTraceBuffer(){
+
+	thread_local tracebuffer* Buffer = NULL;
+
+	if (Buffer == NULL){
+
+		unique_ptr<tracebuffer> NewBuffer(new tracebuffer());
+		NewBuffer->Spans.resize(TraceBufferLen);
+		NewBuffer->SpanCount = 0;
+		NewBuffer->DroppedSpans = 0;
+		Buffer = NewBuffer.get();
+
+		lock_guard<mutex> Lock(TraceBuffersMutex);
+		TraceBuffers.push_back(move(NewBuffer));
+
+	}
+
+	return *Buffer;
+}
+
+void AddTraceSpan(const char* Name, const unsigned long long StartNs, const unsigned long long Arg){ //span from StartNs to now
+
+	tracebuffer& Buffer = getTraceBuffer();
+
+	if (Buffer.SpanCount == TraceBufferLen){
+		Buffer.DroppedSpans++;
+		return;
+	}
+
+	tracespan& Span = Buffer.Spans[Buffer.SpanCount++];
+
+	Span.Name = Name;
+	Span.StartNs = StartNs;
+	Span.EndNs = TraceClock();
+	Span.Arg = Arg;
+
+}
+
+bool WriteTrace(const string& TracefN){ //call once traced threads are idle
+
+	unsigned long DroppedSpans = 0;
+	bool FirstEvent = true;
+	ofstream TraceOut(TracefN.c_str());
+
+	if (!TraceOut.is_open()){
+		cerr << "ERROR: Unable to write trace " << TracefN << endl;
+		return 1;
+	}
+
+	lock_guard<mutex> Lock(TraceBuffersMutex);
+
+	TraceOut << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	TraceOut.setf(ios::fixed);
+	TraceOut.precision(3);
+
+	for (unsigned t = 0; t < TraceBuffers.size(); ++t){
+
+		//thread names label the tracks
+		TraceOut << (FirstEvent ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t + 1 <<
+			",\"args\":{\"name\":\"" << (t == 0 ? "main" : "worker " + to_string(t)) << "\"}}";
+		FirstEvent = false;
+
+		//complete events; microsecond timestamps
+		for (unsigned long n = 0; n < TraceBuffers[t]->SpanCount; ++n){
+
+			const tracespan& Span = TraceBuffers[t]->Spans[n];
+
+			TraceOut << ",\n{\"name\":\"" << Span.Name << "\",\"cat\":\"pipeline\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t + 1 <<
+				",\"ts\":" << Span.StartNs / 1e3 << ",\"dur\":" << (Span.EndNs - Span.StartNs) / 1e3 << ",\"args\":{\"n\":" << Span.Arg << "}}";
+
+		}
+
+		DroppedSpans += TraceBuffers[t]->DroppedSpans;
+	}
+
+	TraceOut << "\n],\"otherData\":{\"dropped_spans\":" << DroppedSpans << "}}\n";
+
+	if (DroppedSpans > 0){
+		cerr << "WARNING: Trace buffers filled; " << DroppedSpans << " spans dropped." << endl;
+	}
+
+	return 0;
+}
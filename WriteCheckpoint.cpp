@@ -0,0 +1,180 @@
+/*
+* Filename : WriteCheckpoint.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Serialises per-sample counters, unfiltered molecule tables and downsampling reads to a compact binary checkpoint
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <unordered_map>
+#include <memory>
+#include <DedupEngine.h>
+
+using namespace std;
+
+void WriteBinaryString(ofstream& Out, const string& Str){
+
+	unsigned Len = Str.length();
+
+	Out.write((const char*) &Len, sizeof(Len));
+	Out.write(Str.data(), Len);
+
+}
+
+void WriteBinaryCount(ofstream& Out, const unsigned long Count){
+
+	unsigned long long Value = Count;
+	Out.write((const char*) &Value, sizeof(Value));
+
+}
+
+//identical read pairs share one body; repeats store its number + 1 instead of the reads
+bool WriteCheckpointBody(ofstream& Out, const shared_ptr<const readbody>& Body, unordered_map<const readbody*, unsigned long>& BodyNos){ //return success or failure
+
+	if (Body == NULL){
+		cerr << "ERROR: Molecules counted without read bodies by the sketch pre-pass cannot be checkpointed." << endl;
+		return 1;
+	}
+
+	auto BodyNo = BodyNos.find(Body.get());
+
+	if (BodyNo != BodyNos.end()){
+		WriteBinaryCount(Out, BodyNo->second + 1);
+		return 0;
+	}
+
+	BodyNos.emplace(Body.get(), BodyNos.size());
+
+	WriteBinaryCount(Out, 0);
+	WriteBinaryString(Out, Body->SeqR1.ToString());
+	WriteBinaryString(Out, Body->SeqR2.ToString());
+	WriteBinaryString(Out, Body->QualR1.ToString());
+	WriteBinaryString(Out, Body->QualR2.ToString());
+	WriteBinaryCount(Out, Body->Fingerprint); //of the unbinned qualities
+
+	return 0;
+}
+
+bool DedupEngine::SaveCheckpoint(const bool Complete){ //return success or failure
+
+	unsigned long long TraceStartNs = SpanStart();
+	const unsigned ByteOrder = 0x01020304; //counts are written in native order
+	vector<unsigned long> RTIHeadersOffsets;
+	unordered_map<const readbody*, unsigned long> BodyNos;
+
+	//RTI headers written so far; trailing lines are discarded on resume
+	if (RTIHeadersOffsetsCallback && RTIHeadersOffsetsCallback(RTIHeadersOffsets) == 1){
+		return 1;
+	}
+
+	RTIHeadersOffsets.resize(Samples.size(), 0);
+
+	Checkpoint.Complete = Complete;
+	Checkpoint.PairsProcessed = PairsRead;
+	Checkpoint.UndeterminedReads = UndeterminedReads;
+
+	//write to a temporary file and rename; a killed job never leaves a partial checkpoint
+	string TempfN = CheckpointfN + ".tmp";
+	ofstream CheckpointOut(TempfN.c_str(), ios::binary);
+
+	if (!CheckpointOut.is_open()){
+		cerr << "ERROR: Unable to write checkpoint " << CheckpointfN << endl;
+		return 1;
+	}
+
+	//header
+	CheckpointOut.write("RADCKPT1", 8);
+	CheckpointOut.write((const char*) &ByteOrder, sizeof(ByteOrder));
+	WriteBinaryString(CheckpointOut, Checkpoint.R1fN);
+	CheckpointOut.put(Checkpoint.Complete);
+	WriteBinaryCount(CheckpointOut, Checkpoint.PairsProcessed);
+	WriteBinaryCount(CheckpointOut, Checkpoint.UndeterminedReads);
+	WriteBinaryCount(CheckpointOut, Checkpoint.EarlierPairs);
+	CheckpointOut.put(Checkpoint.QualityBins);
+	WriteBinaryCount(CheckpointOut, Samples.size());
+
+	for (unsigned n = 0; n < Samples.size(); ++n){
+
+		WriteBinaryString(CheckpointOut, Samples[n].SampleID);
+		WriteBinaryCount(CheckpointOut, RTIHeadersOffsets[n]);
+		WriteBinaryCount(CheckpointOut, Samples[n].TotalPairedReads);
+		WriteBinaryCount(CheckpointOut, Samples[n].LenDiscardedReads);
+		WriteBinaryCount(CheckpointOut, Samples[n].RTIQualityDiscardedReads);
+		WriteBinaryCount(CheckpointOut, Samples[n].PrimerMatchedReads);
+		WriteBinaryCount(CheckpointOut, Samples[n].NMaskedReads);
+		WriteBinaryCount(CheckpointOut, Samples[n].TotalUsableReads);
+
+		WriteBinaryCount(CheckpointOut, Samples[n].AmpliconUsableReads.size());
+		for (const auto & Amplicon : Samples[n].AmpliconUsableReads){
+			WriteBinaryString(CheckpointOut, Amplicon.first);
+			WriteBinaryCount(CheckpointOut, Amplicon.second);
+		}
+
+		//amplicon, RTI, molecule
+		WriteBinaryCount(CheckpointOut, Samples[n].Reads.size());
+		for (const auto & Amplicon : Samples[n].Reads){
+
+			WriteBinaryString(CheckpointOut, Amplicon.first);
+			WriteBinaryCount(CheckpointOut, Amplicon.second.size());
+
+			for (const auto & Read : Amplicon.second){
+				WriteBinaryString(CheckpointOut, Read.first);
+				WriteBinaryCount(CheckpointOut, Read.second.Frequency);
+				CheckpointOut.write((const char*) &Read.second.RTIErrors, sizeof(double));
+				CheckpointOut.write((const char*) &Read.second.ReadErrors, sizeof(double));
+				WriteBinaryString(CheckpointOut, DecodeHeader(Codec, Read.second.Header, 1));
+				WriteBinaryString(CheckpointOut, DecodeHeader(Codec, Read.second.Header, 2));
+
+				if (WriteCheckpointBody(CheckpointOut, Read.second.Body, BodyNos) == 1){
+					CheckpointOut.close();
+					remove(TempfN.c_str());
+					return 1;
+				}
+
+			}
+
+		}
+
+		//amplicon, reads kept for downsampling; most share a molecule's body
+		WriteBinaryCount(CheckpointOut, Samples[n].UnfilteredReads.size());
+		for (const auto & Amplicon : Samples[n].UnfilteredReads){
+
+			WriteBinaryString(CheckpointOut, Amplicon.first);
+			WriteBinaryCount(CheckpointOut, Amplicon.second.size());
+
+			for (const unfilteredread & Read : Amplicon.second){
+
+				WriteBinaryString(CheckpointOut, DecodeHeader(Codec, Read.Header, 1));
+				WriteBinaryString(CheckpointOut, DecodeHeader(Codec, Read.Header, 2));
+
+				if (WriteCheckpointBody(CheckpointOut, Read.Body, BodyNos) == 1){
+					CheckpointOut.close();
+					remove(TempfN.c_str());
+					return 1;
+				}
+
+			}
+
+		}
+
+	}
+
+	StageCounters->BytesWritten += CheckpointOut.tellp();
+
+	CheckpointOut.close();
+
+	if (CheckpointOut.fail() || rename(TempfN.c_str(), CheckpointfN.c_str()) != 0){
+		cerr << "ERROR: Unable to write checkpoint " << CheckpointfN << endl;
+		return 1;
+	}
+
+	LapStage(*StageCounters, OutputStage);
+	EndSpan("checkpoint", TraceStartNs, PairsRead);
+
+	return 0;
+}
@@ -0,0 +1,145 @@
+/*
+* Filename : WriteColumnar.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Writes RTI statistics as zlib compressed column blocks with dictionary encoded amplicons and packed RTIs
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <zlib.h>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+void AppendVarint(string& Buffer, unsigned long long Value){ //LEB128
+
+	while (Value >= 0x80){
+		Buffer += (char) ((Value & 0x7F) | 0x80);
+		Value >>= 7;
+	}
+
+	Buffer += (char) Value;
+}
+
+void WriteColumnarString(ostream& ColumnarOut, const string& Str){
+
+	unsigned Len = Str.length();
+
+	ColumnarOut.write((const char*) &Len, sizeof(Len));
+	ColumnarOut.write(Str.data(), Len);
+}
+
+bool PackRTI(const string& RTI, unsigned long long& PackedRTI){ //3 bits per base below a leading sentinel bit; return success or failure
+
+	//64 bits hold the sentinel & 21 bases; anything else would not unpack to the same RTI
+	if (RTI.length() > 21 || RTI.find_first_not_of("ACGTN") != string::npos){
+		cerr << "ERROR: Binary stats hold RTIs of up to 21 A, C, G, T or N bases; use --stats-format text for " << RTI << endl;
+		return 1;
+	}
+
+	PackedRTI = 1;
+
+	for (unsigned n = 0; n < RTI.length(); ++n){
+
+		PackedRTI <<= 3;
+
+		if (RTI[n] == 'A'){
+			PackedRTI |= 0;
+		} else if (RTI[n] == 'C'){
+			PackedRTI |= 1;
+		} else if (RTI[n] == 'G'){
+			PackedRTI |= 2;
+		} else if (RTI[n] == 'T'){
+			PackedRTI |= 3;
+		} else {
+			PackedRTI |= 4; //N
+		}
+
+	}
+
+	return 0;
+}
+
+void WriteColumnarHeader(ostream& ColumnarOut, const unsigned Table, const string& SampleID, const vector<amplicon>& Amplicons, const unordered_map<string, bool>& AmpliconStrand){
+
+	unsigned AmpliconCount = Amplicons.size();
+
+	ColumnarOut.write("RADCOL01", 8);
+	ColumnarOut.write((const char*) &Table, sizeof(Table));
+	WriteColumnarString(ColumnarOut, SampleID);
+
+	//amplicon dictionary
+	ColumnarOut.write((const char*) &AmpliconCount, sizeof(AmpliconCount));
+
+	for (unsigned n = 0; n < AmpliconCount; ++n){
+		WriteColumnarString(ColumnarOut, Amplicons[n].AmpliconID);
+		ColumnarOut.put(AmpliconStrand.at(Amplicons[n].AmpliconID));
+	}
+
+}
+
+bool WriteColumnarBlock(ostream& ColumnarOut, const unsigned Table, columnarblock& Block){ //return success or failure
+
+	unsigned RecordCount = Block.AmpliconNos.size(), RawLen, CompressedLen;
+	unsigned long long PreviousOrdinal = 0;
+	string Raw;
+
+	if (RecordCount == 0){
+		return 0;
+	}
+
+	//columns
+	for (unsigned n = 0; n < RecordCount; ++n){
+		AppendVarint(Raw, Block.AmpliconNos[n]);
+	}
+
+	for (unsigned n = 0; n < RecordCount; ++n){
+		AppendVarint(Raw, Block.RTIs[n]);
+	}
+
+	for (unsigned n = 0; n < RecordCount; ++n){
+
+		if (Table == 0){ //read pair ordinals only increase; store differences
+			AppendVarint(Raw, Block.Values[n] - PreviousOrdinal);
+			PreviousOrdinal = Block.Values[n];
+		} else {
+			AppendVarint(Raw, Block.Values[n]);
+		}
+
+	}
+
+	if (Table == 1){
+		Raw.append((const char*) Block.ReadErrors.data(), RecordCount * sizeof(double));
+	}
+
+	//compress block
+	uLongf DestLen = compressBound(Raw.length());
+	vector<Bytef> Compressed(DestLen);
+
+	if (compress2(Compressed.data(), &DestLen, (const Bytef*) Raw.data(), Raw.length(), Z_DEFAULT_COMPRESSION) != Z_OK){
+		cerr << "ERROR: Unable to compress a block of binary stats." << endl;
+		return 1;
+	}
+
+	RawLen = Raw.length();
+	CompressedLen = DestLen;
+
+	ColumnarOut.write((const char*) &RecordCount, sizeof(RecordCount));
+	ColumnarOut.write((const char*) &RawLen, sizeof(RawLen));
+	ColumnarOut.write((const char*) &CompressedLen, sizeof(CompressedLen));
+	ColumnarOut.write((const char*) Compressed.data(), CompressedLen);
+
+	getStageCounters().BytesWritten += sizeof(RecordCount) + sizeof(RawLen) + sizeof(CompressedLen) + CompressedLen;
+
+	Block.AmpliconNos.clear();
+	Block.RTIs.clear();
+	Block.Values.clear();
+	Block.ReadErrors.clear();
+
+	return 0;
+}
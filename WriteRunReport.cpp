@@ -0,0 +1,111 @@
+/*
+* Filename : WriteRunReport.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Writes stage timings, counters, peak RSS and per-sample/per-amplicon stats as JSON
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+string JSONString(const string& Value){
+
+	string Escaped = "\"";
+
+	for (char c : Value){
+
+		if (c == '"' || c == '\\'){
+			Escaped += '\\';
+			Escaped += c;
+		} else if ((unsigned char) c < 0x20){
+			Escaped += ' ';
+		} else {
+			Escaped += c;
+		}
+
+	}
+
+	return Escaped + "\"";
+}
+
+bool WriteRunReport(const string& ReportfN, const stagecounters& Counters, const double WallSeconds, const unsigned long PairsRead,
+	const unsigned long UndeterminedReads, const vector<sampledata>& Samples, const vector<amplicon>& Amplicons){
+
+	const char* StageNames[ReportStageCount] = { "parse", "match", "clip", "error_scoring", "hashing", "depth_error_rate_filter", "edit_distance_filter", "output" };
+
+	unsigned n;
+	struct rusage Usage;
+	ofstream ReportOut(ReportfN.c_str());
+
+	if (!ReportOut.is_open()){
+		cerr << "ERROR: Unable to write run report " << ReportfN << endl;
+		return 1;
+	}
+
+	getrusage(RUSAGE_SELF, &Usage);
+
+	ReportOut << "{\n";
+	ReportOut << "  \"wall_seconds\": " << WallSeconds << ",\n";
+	ReportOut << "  \"peak_rss_kb\": " << Usage.ru_maxrss << ",\n";
+	ReportOut << "  \"paired_reads\": " << PairsRead << ",\n";
+	ReportOut << "  \"undetermined_paired_reads\": " << UndeterminedReads << ",\n";
+
+	ReportOut << "  \"stage_seconds\": {";
+	for (n = 0; n < ReportStageCount; ++n){
+		ReportOut << (n == 0 ? "" : ",") << "\n    \"" << StageNames[n] << "\": " << Counters.StageNs[n] / 1e9;
+	}
+	ReportOut << "\n  },\n";
+
+	ReportOut << "  \"counters\": {\n";
+	ReportOut << "    \"alignment_calls\": " << Counters.AlignmentCalls << ",\n";
+	ReportOut << "    \"alignment_calls_per_read\": " << (PairsRead > 0 ? (double) Counters.AlignmentCalls / PairsRead : 0) << ",\n";
+	ReportOut << "    \"hash_probes\": " << Counters.HashProbes << ",\n";
+	ReportOut << "    \"identical_duplicate_reads\": " << Counters.DuplicateReads << ",\n";
+	ReportOut << "    \"exact_clips\": " << Counters.ExactClips << ",\n";
+	ReportOut << "    \"sketch_molecules\": " << Counters.SketchMolecules << ",\n";
+	ReportOut << "    \"sketch_certain_fails\": " << Counters.SketchCertainFails << ",\n";
+	ReportOut << "    \"sketch_certain_fail_rate\": " << (Counters.SketchMolecules > 0 ? (double) Counters.SketchCertainFails / Counters.SketchMolecules : 0) << ",\n";
+	ReportOut << "    \"bytes_read\": " << Counters.BytesRead << ",\n";
+	ReportOut << "    \"bytes_written\": " << Counters.BytesWritten << "\n";
+	ReportOut << "  },\n";
+
+	//the stats printed to stdout
+	ReportOut << "  \"samples\": [";
+	for (n = 0; n < Samples.size(); ++n){
+		ReportOut << (n == 0 ? "" : ",") << "\n    {\"sample_id\": " << JSONString(Samples[n].SampleID) <<
+			", \"total_paired_reads\": " << Samples[n].TotalPairedReads <<
+			", \"n_masked_paired_reads\": " << Samples[n].NMaskedReads <<
+			", \"rti_quality_discarded_paired_reads\": " << Samples[n].RTIQualityDiscardedReads <<
+			", \"unmatched_primer_paired_reads\": " << Samples[n].TotalPairedReads - (Samples[n].PrimerMatchedReads + Samples[n].RTIQualityDiscardedReads + Samples[n].NMaskedReads) <<
+			", \"short_insert_discarded_paired_reads\": " << Samples[n].LenDiscardedReads <<
+			", \"usable_reads\": " << Samples[n].TotalUsableReads <<
+			", \"unique_molecules\": " << Samples[n].TotalUsableMolecules << "}";
+	}
+	ReportOut << "\n  ],\n";
+
+	//read seconds run from the end of parsing to the molecule table update; summed over samples
+	ReportOut << "  \"amplicons\": [";
+	for (n = 0; n < Amplicons.size(); ++n){
+
+		auto Filter = Counters.AmpliconFilterNs.find(Amplicons[n].AmpliconID);
+		auto Output = Counters.AmpliconOutputNs.find(Amplicons[n].AmpliconID);
+
+		ReportOut << (n == 0 ? "" : ",") << "\n    {\"amplicon_id\": " << JSONString(Amplicons[n].AmpliconID) <<
+			", \"matched_reads\": " << (n < Counters.AmpliconReads.size() ? Counters.AmpliconReads[n] : 0) <<
+			", \"read_seconds\": " << (n < Counters.AmpliconReadNs.size() ? Counters.AmpliconReadNs[n] : 0) / 1e9 <<
+			", \"filter_seconds\": " << (Filter == Counters.AmpliconFilterNs.end() ? 0 : Filter->second) / 1e9 <<
+			", \"output_seconds\": " << (Output == Counters.AmpliconOutputNs.end() ? 0 : Output->second) / 1e9 << "}";
+
+	}
+	ReportOut << "\n  ]\n";
+	ReportOut << "}\n";
+
+	return 0;
+}
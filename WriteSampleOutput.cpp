@@ -0,0 +1,224 @@
+/*
+* Filename : WriteSampleOutput.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Prints filtered molecules, downsampled reads and duplication statistics for one sample, amplicon by amplicon
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <SampleOutput.h>
+
+using namespace std;
+
+unsigned long WriteFastqRecord(ostream* FastqOut, const string& Header, const string& Seq, const string& Qual){ //returns bytes written
+
+	if (FastqOut == NULL){
+		return 0;
+	}
+
+	*FastqOut << Header << "\012";
+	*FastqOut << Seq << "\012+\012";
+	*FastqOut << Qual << "\012";
+
+	return Header.length() + Seq.length() + Qual.length() + 4;
+}
+
+void PrintSampleReadCounts(const sampledata& Sample){
+
+	cout << "\nTotalPairedReads: " << Sample.TotalPairedReads << endl;
+	cout << "N-MaskedPairedReads: " << Sample.NMaskedReads << " (" << ((float)Sample.NMaskedReads / Sample.TotalPairedReads) * 100 << "%)" << endl;
+	cout << "RTIQualityDiscardedPairedReads: " << Sample.RTIQualityDiscardedReads << " (" << ((float)Sample.RTIQualityDiscardedReads / Sample.TotalPairedReads) * 100 << "%)" << endl;
+	cout << "UnmatchedPrimerPairedReads: " << Sample.TotalPairedReads - (Sample.PrimerMatchedReads + Sample.RTIQualityDiscardedReads + Sample.NMaskedReads) << " (" << ((float)(Sample.TotalPairedReads - (Sample.PrimerMatchedReads + Sample.RTIQualityDiscardedReads + Sample.NMaskedReads)) / Sample.TotalPairedReads) * 100 << "%)" << endl;
+	cout << "ShortInsertDiscardedPairedReads: " << Sample.LenDiscardedReads << " (" << ((float)Sample.LenDiscardedReads / Sample.TotalPairedReads) * 100 << "%)" << endl;
+	cout << "Amplicon\tUsableReads\tUniqueReads\tDuplicationRate" << endl;
+
+}
+
+unsigned long getAmpliconCount(const unordered_map<string, unsigned long>& AmpliconCounts, const string& AmpliconID){
+
+	unordered_map<string, unsigned long>::const_iterator Count = AmpliconCounts.find(AmpliconID);
+	return Count == AmpliconCounts.end() ? 0 : Count->second;
+
+}
+
+void PrintAmpliconReadCounts(const sampledata& Sample, const string& AmpliconID){
+
+	if (Sample.AmpliconUsableReads.count(AmpliconID) == 1){ //reads associated with this amplicon
+		const unsigned long UsableReads = Sample.AmpliconUsableReads.at(AmpliconID), UniqueReads = getAmpliconCount(Sample.AmpliconUniqueReads, AmpliconID);
+		cout << AmpliconID << "\t" << UsableReads << "\t" << UniqueReads << "\t" << (1 - ((float)UniqueReads / UsableReads)) * 100 << "%" << endl;
+	} else {
+		cout << AmpliconID << "\t" << 0 << "\t" << 0 << "\t" << 0 << endl;
+	}
+
+}
+
+void PrintSampleMoleculeCounts(const sampledata& Sample){
+
+	cout << "UniqueMolecules: " << Sample.TotalUsableMolecules << " (" << ((float)Sample.TotalUsableMolecules / Sample.TotalUsableReads) * 100 << "%)" << endl;
+	cout << "DuplicationRate: " << (1 - ((float)Sample.TotalUsableMolecules / Sample.TotalUsableReads)) * 100 << "%" << endl << endl;
+
+}
+
+bool WriteSampleOutput(DedupEngine& Engine, const unsigned SampleNo, const bool BinaryStats, const sampleoutputs& Outputs){ //return success or failure
+
+	unsigned n;
+	bool PackFailed = false;
+	unsigned long long PackedRTI;
+	vector<unsigned long> Molecules, DownsampledReads; //records written per amplicon
+	bool Strand;
+	unsigned long long StartNs;
+	columnarblock StatsBlock;
+	string Tags;
+	stagecounters& Counters = getStageCounters();
+	const sampledata& Sample = Engine.getSamples()[SampleNo];
+	const vector<amplicon>& Amplicons = Engine.getAmplicons();
+	const unordered_map<string, bool>& AmpliconStrand = Engine.getAmpliconStrand();
+	const headercodec& Codec = Engine.getCodec();
+
+	//print stats headers
+	if (Outputs.Stats != NULL && BinaryStats == true){
+		WriteColumnarHeader(*Outputs.Stats, 1, Sample.SampleID, Amplicons, AmpliconStrand);
+	} else if (Outputs.Stats != NULL){
+		*Outputs.Stats << "SampleID\tAmplicon\tStrand\tRTI\tFrequency (Reads)\tSequenceErrors\n";
+	}
+
+	//print stats
+	PrintSampleReadCounts(Sample);
+
+	Molecules.assign(Amplicons.size(), 0);
+	DownsampledReads.assign(Amplicons.size(), 0);
+
+	//filter then print passing records and per-amplicon stats; each amplicon is written as soon as its filters finish
+	for (n = 0; n < Amplicons.size(); ++n){
+
+		if (Engine.IncludesAmplicon(n) == false){
+			continue; //another shard's amplicon
+		}
+
+		LapStage(Counters, OutputStage);
+		Engine.FinalizeAmplicon(SampleNo, n);
+
+		StartNs = StageClock(Counters);
+		Strand = AmpliconStrand.at(Amplicons[n].AmpliconID);
+
+		Engine.ForEachMolecule(SampleNo, n, [&](const string& RTI, const molecule& Molecule){
+
+			const string SeqR1 = Molecule.Body->SeqR1.ToString(), SeqR2 = Molecule.Body->SeqR2.ToString();
+			const string QualR1 = Molecule.Body->QualR1.ToString(), QualR2 = Molecule.Body->QualR2.ToString();
+
+			Molecules[n]++;
+
+			Counters.BytesWritten += WriteFastqRecord(Outputs.Dedupped[Strand][0], DecodeHeader(Codec, Molecule.Header, 1), SeqR1, QualR1);
+			Counters.BytesWritten += WriteFastqRecord(Outputs.Dedupped[Strand][1], DecodeHeader(Codec, Molecule.Header, 2), SeqR2, QualR2);
+
+			//paired, unmapped, mate unmapped, first/last in pair; carries what _RTIs.txt would be joined on
+			if (Outputs.Bam != NULL){
+
+				Tags.clear();
+				AppendBamStringTag(Tags, "RG", Sample.SampleID);
+				AppendBamStringTag(Tags, "RX", RTI);
+				AppendBamStringTag(Tags, "ZA", Amplicons[n].AmpliconID);
+				AppendBamIntTag(Tags, "ZS", Strand);
+				AppendBamIntTag(Tags, "ZF", Molecule.Frequency);
+				AppendBamFloatTag(Tags, "ZE", Molecule.ReadErrors);
+
+				WriteBamRecord(*Outputs.Bam, DecodeHeader(Codec, Molecule.Header, 1), SeqR1, QualR1, 77, Engine.getParameters().QScorePhredOffset, Tags);
+				WriteBamRecord(*Outputs.Bam, DecodeHeader(Codec, Molecule.Header, 2), SeqR2, QualR2, 141, Engine.getParameters().QScorePhredOffset, Tags);
+			}
+
+			//AmpliconID, RTI, RTI_Frequency, RTI_ReadErrors
+			if (Outputs.Stats == NULL){
+				return;
+			} else if (BinaryStats == true){
+				PackFailed = PackFailed || PackRTI(RTI, PackedRTI) == 1;
+				StatsBlock.AmpliconNos.push_back(n);
+				StatsBlock.RTIs.push_back(PackedRTI);
+				StatsBlock.Values.push_back(Molecule.Frequency);
+				StatsBlock.ReadErrors.push_back(Molecule.ReadErrors);
+			} else {
+				*Outputs.Stats << Sample.SampleID << "\t" << Amplicons[n].AmpliconID << "\t" << Strand << "\t" << RTI << "\t" << Molecule.Frequency << "\t" << Molecule.ReadErrors << "\n";
+			}
+
+		});
+
+		//one compressed block per amplicon
+		if (PackFailed == true || (Outputs.Stats != NULL && WriteColumnarBlock(*Outputs.Stats, 1, StatsBlock) == 1)){
+			return 1;
+		}
+
+		//let downstream tools start on this amplicon
+		for (unsigned r = 0; r < 2; ++r){
+			if (Outputs.Dedupped[Strand][r] != NULL){
+				Outputs.Dedupped[Strand][r]->flush();
+			}
+		}
+
+		//print per amplicon stats
+		PrintAmpliconReadCounts(Sample, Amplicons[n].AmpliconID);
+
+		if (Counters.Timed == true){
+			Counters.AmpliconOutputNs[Amplicons[n].AmpliconID] += StageClock(Counters) - StartNs;
+		}
+
+	} //finish iterating over amplicons
+
+	PrintSampleMoleculeCounts(Sample);
+
+	//print unfiltered downsampled reads
+	for (n = 0; n < Amplicons.size(); ++n){
+
+		if (Engine.IncludesAmplicon(n) == false){
+			continue;
+		}
+
+		StartNs = StageClock(Counters);
+		Strand = AmpliconStrand.at(Amplicons[n].AmpliconID);
+
+		Engine.ForEachDownsampledRead(SampleNo, n, [&](const unfilteredread& Read){
+
+			DownsampledReads[n]++;
+
+			Counters.BytesWritten += WriteFastqRecord(Outputs.Trimmed[Strand][0], DecodeHeader(Codec, Read.Header, 1), Read.Body->SeqR1.ToString(), Read.Body->QualR1.ToString());
+			Counters.BytesWritten += WriteFastqRecord(Outputs.Trimmed[Strand][1], DecodeHeader(Codec, Read.Header, 2), Read.Body->SeqR2.ToString(), Read.Body->QualR2.ToString());
+
+		});
+
+		if (Counters.Timed == true){
+			Counters.AmpliconOutputNs[Amplicons[n].AmpliconID] += StageClock(Counters) - StartNs;
+		}
+
+	}
+
+	//counters & record counts the shard merge needs to rebuild an unsharded run
+	if (Outputs.Summary != NULL){
+
+		*Outputs.Summary << "TotalPairedReads\t" << Sample.TotalPairedReads << "\n";
+		*Outputs.Summary << "NMaskedReads\t" << Sample.NMaskedReads << "\n";
+		*Outputs.Summary << "RTIQualityDiscardedReads\t" << Sample.RTIQualityDiscardedReads << "\n";
+		*Outputs.Summary << "PrimerMatchedReads\t" << Sample.PrimerMatchedReads << "\n";
+		*Outputs.Summary << "LenDiscardedReads\t" << Sample.LenDiscardedReads << "\n";
+		*Outputs.Summary << "TotalUsableReads\t" << Sample.TotalUsableReads << "\n";
+		*Outputs.Summary << "TotalUsableMolecules\t" << Sample.TotalUsableMolecules << "\n";
+
+		//AmpliconID, UsableReads, UniqueReads, Dedupped records, Trimmed records
+		for (n = 0; n < Amplicons.size(); ++n){
+			if (Engine.IncludesAmplicon(n) == true && Sample.AmpliconUsableReads.count(Amplicons[n].AmpliconID) == 1){
+				*Outputs.Summary << "Amplicon\t" << Amplicons[n].AmpliconID << "\t" << Sample.AmpliconUsableReads.at(Amplicons[n].AmpliconID) << "\t" <<
+					getAmpliconCount(Sample.AmpliconUniqueReads, Amplicons[n].AmpliconID) << "\t" << Molecules[n] << "\t" << DownsampledReads[n] << "\n";
+			}
+		}
+
+	}
+
+	//columnar blocks are counted as they are written
+	if (Outputs.Stats != NULL && BinaryStats == false && Outputs.Stats->tellp() > 0){
+		Counters.BytesWritten += Outputs.Stats->tellp();
+	}
+
+	return 0;
+}
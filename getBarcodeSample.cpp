@@ -0,0 +1,46 @@
+/*
+* Filename : getBarcodeSample.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Returns the sample assigned to an observed index barcode or -1 if undetermined
+* Status: Release
+*/
+
+#include <string>
+#include <unordered_map>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+int getBarcodeSample(const unordered_map<string, int>& BarcodeLookup, const string& Barcode, const unsigned Index1Len, const unsigned Index2Len){
+
+	string Key;
+	size_t SeparatorPos = Barcode.find('+');
+
+	//trim index reads to the sample sheet barcode length
+	Key = Barcode.substr(0, SeparatorPos);
+
+	if (Key.length() < Index1Len){
+		return -1;
+	}
+
+	Key = Key.substr(0, Index1Len);
+
+	if (Index2Len > 0){
+
+		if (SeparatorPos == string::npos || Barcode.length() - SeparatorPos - 1 < Index2Len){
+			return -1;
+		}
+
+		Key += '+' + Barcode.substr(SeparatorPos + 1, Index2Len);
+	}
+
+	unordered_map<string, int>::const_iterator Sample = BarcodeLookup.find(Key);
+
+	if (Sample == BarcodeLookup.end()){
+		return -1;
+	}
+
+	return Sample->second;
+
+}
@@ -0,0 +1,34 @@
+/*
+* Filename : getFastqRecord.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Reads one four line FASTQ record; paired reads may come from two files or one interleaved stream
+* Status: Release
+*/
+
+#include <istream>
+#include <string>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+bool getFastqRecord(istream& FastqIn, string& Header, string& Seq, string& Qual, unsigned long long& BytesRead){ //return true if a whole record was read
+
+	string Separator;
+
+	//Skip empty lines
+	do {
+		if (!getline(FastqIn, Header)){
+			return false;
+		}
+		BytesRead += Header.length() + 1;
+	} while (Header == "");
+
+	if (!getline(FastqIn, Seq) || !getline(FastqIn, Separator) || !getline(FastqIn, Qual)){
+		return false;
+	}
+
+	BytesRead += Seq.length() + Separator.length() + Qual.length() + 3;
+
+	return true;
+}
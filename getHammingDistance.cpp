@@ -7,15 +7,32 @@
 */
 
 #include <string>
+#include <cstring>
+#include <cstdint>
 #include <RemoveAmpliconDuplicates.h>
 
 using namespace std;
 
 unsigned getHammingDistance(const string& str1, const string& str2){
 
-	unsigned HammingDistance = 0;
+	unsigned HammingDistance = 0, n = 0;
+	uint64_t Word1, Word2, Diff;
 
-	for (unsigned n = 0; n < str1.length(); ++n){ //must be the same length
+	//eight characters at a time; one flag bit per differing byte
+	for (; n + 8 <= str1.length(); n += 8){ //must be the same length
+
+		memcpy(&Word1, str1.data() + n, 8);
+		memcpy(&Word2, str2.data() + n, 8);
+
+		Diff = Word1 ^ Word2;
+		Diff |= Diff >> 4;
+		Diff |= Diff >> 2;
+		Diff |= Diff >> 1;
+
+		HammingDistance += __builtin_popcountll(Diff & 0x0101010101010101ULL);
+	}
+
+	for (; n < str1.length(); ++n){
 		if (str1[n] != str2[n]){
 			HammingDistance++;
 		}
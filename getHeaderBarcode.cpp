@@ -0,0 +1,24 @@
+/*
+* Filename : getHeaderBarcode.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Returns the index barcode from the comment of an Illumina 1.8+ read header (@... 1:N:0:BARCODE)
+* Status: Release
+*/
+
+#include <string>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+string getHeaderBarcode(const string& Header){
+
+	size_t CommentPos = Header.find(' '), BarcodePos = Header.find_last_of(':');
+
+	if (CommentPos == string::npos || BarcodePos == string::npos || BarcodePos < CommentPos){
+		return ""; //no barcode in comment field
+	}
+
+	return Header.substr(BarcodePos + 1, string::npos);
+
+}
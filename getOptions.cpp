@@ -0,0 +1,198 @@
+/*
+* Filename : getOptions.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Extracts optional settings supplied after the positional arguments
+* Status: Release
+*/
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+bool getOptions(int argc, char* argv[], options& Options){ //return success or failure
+
+	string Option;
+	int Value;
+	bool BamThreadsSet = false;
+
+	//defaults
+	Options.SampleSheetfN = "";
+	Options.Index1fN = "";
+	Options.Index2fN = "";
+	Options.MaxBarcodeMismatches = 1;
+	Options.CheckpointfN = "";
+	Options.ResumefN = "";
+	Options.CheckpointInterval = 10000000;
+	Options.SketchPrepass = false;
+	Options.BinaryStats = false;
+	Options.ReportfN = "";
+	Options.TracefN = "";
+	Options.ProgressTarget = "";
+	Options.ProgressInterval = 10;
+	Options.Stream = string(argv[2]) == "-" && string(argv[3]) == "-";
+	Options.SampleID = "stdin";
+	Options.StatsfN = "";
+	Options.RTIHeadersfN = "";
+	Options.TrimmedfN = "";
+	Options.Bam = false;
+	Options.BamThreads = 1;
+	Options.QualityBins = false;
+	Options.ShardNo = 0;
+	Options.ShardCount = 0;
+
+	//options follow <AmpliconList> <R1.fastq> <R2.fastq>
+	for (int n = 4; n < argc; ++n){
+
+		Option = argv[n];
+
+		//switches
+		if (Option == "--sketch-prepass"){
+			Options.SketchPrepass = true;
+			continue;
+		} else if (Option == "--bam"){
+			Options.Bam = true;
+			continue;
+		} else if (Option == "--qual-bins"){
+			Options.QualityBins = true;
+			continue;
+		}
+
+		//remaining options take a value
+		if (n + 1 == argc){
+			cerr << "ERROR: Missing value for option " << Option << endl;
+			return 1;
+		}
+
+		if (Option == "--samplesheet"){
+			Options.SampleSheetfN = argv[++n];
+		} else if (Option == "--index1"){
+			Options.Index1fN = argv[++n];
+		} else if (Option == "--index2"){
+			Options.Index2fN = argv[++n];
+		} else if (Option == "--barcode-mismatches"){
+
+			Value = atoi(argv[++n]);
+
+			//variants grow as 4^n per barcode
+			if (Value < 0 || Value > 3){
+				cerr << "ERROR: --barcode-mismatches must be between 0 and 3." << endl;
+				return 1;
+			}
+
+			Options.MaxBarcodeMismatches = Value;
+
+		} else if (Option == "--checkpoint"){
+			Options.CheckpointfN = argv[++n];
+		} else if (Option == "--checkpoint-interval"){
+			Options.CheckpointInterval = strtoul(argv[++n], NULL, 10);
+		} else if (Option == "--resume"){
+			Options.ResumefN = argv[++n];
+		} else if (Option == "--report-json"){
+			Options.ReportfN = argv[++n];
+		} else if (Option == "--trace"){
+			Options.TracefN = argv[++n];
+		} else if (Option == "--progress"){
+			Options.ProgressTarget = argv[++n];
+		} else if (Option == "--progress-interval"){
+			Options.ProgressInterval = atoi(argv[++n]);
+		} else if (Option == "--sample-id"){
+			Options.SampleID = argv[++n];
+		} else if (Option == "--stats"){
+			Options.StatsfN = argv[++n];
+		} else if (Option == "--rti-headers"){
+			Options.RTIHeadersfN = argv[++n];
+		} else if (Option == "--trimmed"){
+			Options.TrimmedfN = argv[++n];
+		} else if (Option == "--bam-threads"){
+
+			Value = atoi(argv[++n]);
+
+			if (Value < 1 || Value > 256){
+				cerr << "ERROR: --bam-threads must be between 1 and 256." << endl;
+				return 1;
+			}
+
+			Options.BamThreads = Value;
+			BamThreadsSet = true;
+
+		} else if (Option == "--shard"){
+
+			Option = argv[++n];
+
+			if (sscanf(Option.c_str(), "%u/%u", &Options.ShardNo, &Options.ShardCount) != 2 ||
+				Options.ShardCount == 0 || Options.ShardNo == 0 || Options.ShardNo > Options.ShardCount){
+				cerr << "ERROR: --shard must be i/N with 1 <= i <= N." << endl;
+				return 1;
+			}
+
+		} else if (Option == "--stats-format"){
+
+			Option = argv[++n];
+
+			if (Option == "binary"){
+				Options.BinaryStats = true;
+			} else if (Option != "text"){
+				cerr << "ERROR: --stats-format must be text or binary." << endl;
+				return 1;
+			}
+
+		} else {
+			cerr << "ERROR: Unknown option " << Option << endl;
+			return 1;
+		}
+
+	}
+
+	if ((Options.Index1fN != "" || Options.Index2fN != "") && Options.SampleSheetfN == ""){
+		cerr << "ERROR: Index reads supplied without a sample sheet." << endl;
+		return 1;
+	}
+
+	if (Options.Index2fN != "" && Options.Index1fN == ""){
+		cerr << "ERROR: Index2 reads supplied without Index1 reads." << endl;
+		return 1;
+	}
+
+	if (Options.ProgressInterval == 0){
+		cerr << "ERROR: --progress-interval must be at least one second." << endl;
+		return 1;
+	}
+
+	if (Options.SketchPrepass == true && (Options.CheckpointfN != "" || Options.ResumefN != "")){
+		cerr << "ERROR: --sketch-prepass cannot be combined with checkpoints; skipped molecules could pass after a top-up." << endl;
+		return 1;
+	}
+
+	if (Options.Stream == false && (string(argv[2]) == "-" || string(argv[3]) == "-")){
+		cerr << "ERROR: Streaming mode reads interleaved FASTQ from stdin; give - for both R1 and R2." << endl;
+		return 1;
+	}
+
+	if (Options.Stream == false && (Options.StatsfN != "" || Options.RTIHeadersfN != "" || Options.TrimmedfN != "")){
+		cerr << "ERROR: --stats, --rti-headers and --trimmed name streaming mode outputs; file mode derives them from R1." << endl;
+		return 1;
+	}
+
+	if (Options.Stream == true && (Options.SampleSheetfN != "" || Options.CheckpointfN != "" || Options.ResumefN != "" || Options.SketchPrepass == true)){
+		cerr << "ERROR: Streaming mode cannot be combined with --samplesheet, --checkpoint, --resume or --sketch-prepass." << endl;
+		return 1;
+	}
+
+	if (BamThreadsSet == true && Options.Bam == false){
+		cerr << "ERROR: --bam-threads compresses --bam output; give --bam as well." << endl;
+		return 1;
+	}
+
+	if (Options.ShardCount > 0 && (Options.Stream == true || Options.Bam == true || Options.BinaryStats == true || Options.CheckpointfN != "" || Options.ResumefN != "")){
+		cerr << "ERROR: --shard writes text stats & FASTQs for merging; it cannot be combined with streaming, --bam, binary stats, --checkpoint or --resume." << endl;
+		return 1;
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,100 @@
+/*
+* Filename : getSamples.cpp
+* Author : Matthew Lyon, Wessex Regional Genetics Laboratory, Salisbury, UK & University of Southampton, UK
+* Contact : mlyon@live.co.uk
+* Description : Extracts sample identifiers and index barcodes from the supplied sample sheet
+* Status: Release
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include <RemoveAmpliconDuplicates.h>
+
+using namespace std;
+
+bool getSamples(ifstream& SamplesIn, vector<samplesheetentry>& SampleSheet){ //return success or failure
+
+	unsigned short n;
+	string SampleLine;
+	samplesheetentry Temp;
+	vector<string> SampleFields;
+
+	if (SamplesIn.is_open()) {
+		while (SamplesIn.good()) {
+			getline(SamplesIn, SampleLine);
+
+			SampleFields.clear();
+
+			boost::trim(SampleLine); //remove whitespace at either end of line
+
+			//skip empty lines and headers
+			if (SampleLine == "" || SampleLine[0] == '#') {
+				continue;
+			}
+
+			//tokenize string
+			boost::split(SampleFields, SampleLine, boost::is_any_of("\t"), boost::token_compress_on);
+
+			if (SampleFields.size() != 2 && SampleFields.size() != 3) {
+				cerr << "ERROR: Sample sheet improperly formatted." << endl;
+				cerr << "SampleSheet: SampleID Index1 [Index2]\n" << endl;
+				return 1;
+			}
+
+			//check barcodes are standard DNA seq
+			for (unsigned short i = 1; i < SampleFields.size(); ++i){
+
+				boost::to_upper(SampleFields[i]);
+
+				for (n = 0; n < SampleFields[i].length(); ++n){
+					if (SampleFields[i][n] != 'A' &&
+						SampleFields[i][n] != 'T' &&
+						SampleFields[i][n] != 'G' &&
+						SampleFields[i][n] != 'C'){
+
+						cerr << "ERROR: Index barcode contains non-standard bases (only A,T,G or C allowed)" << endl;
+						return 1;
+
+					}
+				}
+			}
+
+			//bank sample
+			Temp.SampleID = SampleFields[0];
+			Temp.Barcode = SampleFields[1];
+
+			if (SampleFields.size() == 3){
+				Temp.Barcode += '+' + SampleFields[2];
+			}
+
+			//all barcodes must share the same layout for lookup
+			if (SampleSheet.size() > 0 && SampleSheet[0].Barcode.find('+') != Temp.Barcode.find('+')){
+				cerr << "ERROR: Index barcodes must all have the same length." << endl;
+				return 1;
+			} else if (SampleSheet.size() > 0 && SampleSheet[0].Barcode.length() != Temp.Barcode.length()){
+				cerr << "ERROR: Index barcodes must all have the same length." << endl;
+				return 1;
+			}
+
+			SampleSheet.push_back(Temp);
+
+		}
+
+		SamplesIn.close();
+
+	} else {
+		cerr << "ERROR: Unable to open sample sheet" << endl;
+		return 1;
+	}
+
+	if (SampleSheet.size() == 0){
+		cerr << "ERROR: Sample sheet contains no samples" << endl;
+		return 1;
+	}
+
+	return 0;
+
+}